@@ -19,6 +19,7 @@
 #include "common.h"
 #include "rds.h"
 #include "fm_mpx.h"
+#include "modulator.h"
 #include "lib.h"
 #include "ascii_cmd.h"
 
@@ -36,6 +37,17 @@ void process_ascii_cmd(unsigned char *str) {
 	while (str[cmd_len] != 0 && cmd_len < CTL_BUFFER_SIZE)
 		cmd_len++;
 
+#ifndef FIXED_POINT
+	if (cmd_len == 5) {
+		cmd = str;
+
+		if (CMD_MATCHES("METER")) {
+			print_mpx_meters();
+			return;
+		}
+	}
+#endif
+
 	if (cmd_len > 3 && str[2] == ' ') {
 		cmd = str;
 		cmd[2] = 0;
@@ -169,6 +181,25 @@ void process_ascii_cmd(unsigned char *str) {
 			set_output_volume(strtof((char *)arg, NULL));
 			return;
 		}
+		if (CMD_MATCHES("PPM")) {
+			if (arg[0] == 'A' || arg[0] == 'a') {
+				set_auto_ppm(true);
+			} else {
+				set_auto_ppm(false);
+				set_output_ppm(strtof((char *)arg, NULL));
+			}
+			return;
+		}
+#ifndef FIXED_POINT
+		if (CMD_MATCHES("LIM")) {
+			float ceiling, release;
+			if (sscanf((char *)arg, "%f,%f",
+				&ceiling, &release) == 2) {
+				set_mpx_limiter(ceiling, release);
+			}
+			return;
+		}
+#endif
 		if (CMD_MATCHES("LPS")) {
 			arg[LPS_LENGTH] = 0;
 			if (arg[0] == '-') arg[0] = 0;
@@ -188,6 +219,17 @@ void process_ascii_cmd(unsigned char *str) {
 		cmd[4] = 0;
 		arg = str + 5;
 
+#ifdef RDS2
+		if (CMD_MATCHES("RDS2")) {
+			arg[1] = 0;
+			set_rds2_streams(strtoul((char *)arg, NULL, 10));
+			return;
+		}
+		if (CMD_MATCHES("QUAD")) {
+			set_rds2_quadrature(arg[0] == '1');
+			return;
+		}
+#endif
 		if (CMD_MATCHES("RTPF")) {
 			arg[1] = 0;
 			set_rds_rtplus_flags(strtoul((char *)arg, NULL, 10));
@@ -227,5 +269,17 @@ void process_ascii_cmd(unsigned char *str) {
 			set_rds_ertplus_flags(strtoul((char *)arg, NULL, 10));
 			return;
 		}
+#ifdef RDS2
+		if (CMD_MATCHES("SHIFT")) {
+			float shifts[3];
+			if (sscanf((char *)arg, "%f,%f,%f",
+				&shifts[0], &shifts[1], &shifts[2]) == 3) {
+				set_rds_symbol_shift(1, shifts[0]);
+				set_rds_symbol_shift(2, shifts[1]);
+				set_rds_symbol_shift(3, shifts[2]);
+			}
+			return;
+		}
+#endif
 	}
 }
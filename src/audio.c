@@ -0,0 +1,208 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "rds.h"
+#include "fm_mpx.h"
+#include "filter.h"
+#include "resampler.h"
+#include "input.h"
+#include "audio.h"
+
+/*
+ * Audio input for the stereo encoder
+ *
+ * Audio comes from a WAV or raw (S16LE stereo) file, stdin or an ALSA
+ * capture device. It is pre-emphasized and band-limited at its own
+ * rate, turned into mid (L+R) and side (L-R) signals and resampled to
+ * the MPX rate.
+ *
+ */
+
+static bool audio_active;
+
+static struct input_t audio_in;
+
+static bool use_preemphasis;
+static struct preemphasis_t preemph[2];
+static struct lowpass_t lowpass_filter[2];
+
+static bool resampling;
+static struct resampler_t resampler;
+
+/* one chunk of input */
+static int16_t *in_buffer;
+/* filtered chunk (mid/side, interleaved) */
+static float *chunk_buffer;
+
+/* frames of the chunk not used yet */
+static size_t chunk_pos;
+static size_t chunk_frames;
+
+/* resampler output, before it is split into mid and side */
+static float *out_buffer;
+
+/*
+ * Open an audio source
+ *
+ * The rate is only used for raw audio and ALSA
+ */
+int8_t open_audio_input(char *name, uint32_t rate, float preemph_us) {
+	if (open_input(&audio_in, name, rate, 2) < 0) return -1;
+
+	/* from here on close_audio_input() cleans up */
+	audio_active = true;
+
+	use_preemphasis = preemph_us > 0.0f;
+	for (uint8_t i = 0; i < 2; i++) {
+		if (use_preemphasis)
+			preemphasis_init(&preemph[i], audio_in.rate, preemph_us);
+		lowpass_init(&lowpass_filter[i], audio_in.rate,
+			AUDIO_CUTOFF, AUDIO_TRANSITION);
+	}
+
+	in_buffer = malloc(AUDIO_CHUNK_FRAMES * audio_in.channels
+		* sizeof(int16_t));
+	chunk_buffer = malloc(AUDIO_CHUNK_FRAMES * 2 * sizeof(float));
+
+	chunk_pos = chunk_frames = 0;
+
+	resampling = audio_in.rate != MPX_SAMPLE_RATE;
+	if (resampling) {
+		out_buffer = malloc(NUM_MPX_FRAMES_IN * 2 * sizeof(float));
+
+		if (resampler_init(&resampler, audio_in.rate,
+			MPX_SAMPLE_RATE, 2) < 0) {
+			resampling = false;
+			free(out_buffer);
+			close_audio_input();
+			return -1;
+		}
+	}
+
+	fprintf(stderr, "Audio input: %s, %u Hz, %u channel(s).\n",
+		name, audio_in.rate, audio_in.channels);
+
+	return 0;
+}
+
+bool audio_input_active() {
+	return audio_active;
+}
+
+/*
+ * Get the next chunk and filter it
+ *
+ */
+static void refill() {
+	uint8_t *bytes = (uint8_t *)in_buffer;
+	float l, r;
+
+	read_input(&audio_in, in_buffer, AUDIO_CHUNK_FRAMES);
+
+	for (size_t i = 0; i < AUDIO_CHUNK_FRAMES; i++) {
+		/* input is little endian */
+		l = (int16_t)(bytes[0] | bytes[1] << 8) / 32768.0f;
+		if (audio_in.channels == 2) {
+			r = (int16_t)(bytes[2] | bytes[3] << 8) / 32768.0f;
+		} else {
+			r = l;
+		}
+		bytes += audio_in.channels * sizeof(int16_t);
+
+		if (use_preemphasis) {
+			l = preemphasis(&preemph[0], l);
+			r = preemphasis(&preemph[1], r);
+		}
+		l = lowpass(&lowpass_filter[0], l);
+		r = lowpass(&lowpass_filter[1], r);
+
+		chunk_buffer[2*i+0] = (l + r) * 0.5f;
+		chunk_buffer[2*i+1] = (l - r) * 0.5f;
+	}
+
+	chunk_pos = 0;
+	chunk_frames = AUDIO_CHUNK_FRAMES;
+}
+
+/*
+ * Get a block of mid and side samples at the MPX rate
+ *
+ * Whatever part of the chunk the resampler doesn't take is kept for
+ * the next block.
+ */
+void get_audio_samples(float *mid, float *side, size_t num_frames) {
+	const float *in;
+	size_t used, frames;
+
+	while (num_frames) {
+		if (chunk_pos == chunk_frames) refill();
+
+		if (resampling) {
+			frames = num_frames;
+			if (frames > NUM_MPX_FRAMES_IN)
+				frames = NUM_MPX_FRAMES_IN;
+			if (resample(&resampler, chunk_buffer + 2 * chunk_pos,
+				chunk_frames - chunk_pos, &used,
+				out_buffer, frames, &frames) < 0) {
+				memset(mid, 0, num_frames * sizeof(float));
+				memset(side, 0, num_frames * sizeof(float));
+				return;
+			}
+			in = out_buffer;
+		} else {
+			frames = chunk_frames - chunk_pos;
+			if (frames > num_frames) frames = num_frames;
+			in = chunk_buffer + 2 * chunk_pos;
+			used = frames;
+		}
+
+		for (size_t i = 0; i < frames; i++) {
+			mid[i] = in[2*i+0];
+			side[i] = in[2*i+1];
+		}
+
+		chunk_pos += used;
+		mid += frames;
+		side += frames;
+		num_frames -= frames;
+	}
+}
+
+void close_audio_input() {
+	if (!audio_active) return;
+	audio_active = false;
+
+	close_input(&audio_in);
+
+	if (resampling) {
+		resampler_exit(&resampler);
+		free(out_buffer);
+		resampling = false;
+	}
+
+	for (uint8_t i = 0; i < 2; i++) {
+		lowpass_exit(&lowpass_filter[i]);
+	}
+
+	free(in_buffer);
+	free(chunk_buffer);
+	in_buffer = NULL;
+	chunk_buffer = NULL;
+	out_buffer = NULL;
+}
@@ -0,0 +1,38 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* sample rate of raw input when none is given */
+#define DEFAULT_AUDIO_RATE	48000
+
+/* audio frames read from the input at a time */
+#define AUDIO_CHUNK_FRAMES	256
+
+/* 15 kHz audio bandwidth (the pilot has to stay clear) */
+#define AUDIO_CUTOFF		17000.0f
+#define AUDIO_TRANSITION	4000.0f
+
+#ifdef RBDS
+#define DEFAULT_PREEMPHASIS	75.0f
+#else
+#define DEFAULT_PREEMPHASIS	50.0f
+#endif
+
+extern int8_t open_audio_input(char *name, uint32_t rate, float preemph_us);
+extern bool audio_input_active();
+extern void get_audio_samples(float *mid, float *side, size_t num_frames);
+extern void close_audio_input();
@@ -0,0 +1,298 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* for clock_gettime */
+#define _POSIX_C_SOURCE 199309L
+
+#include "common.h"
+#include "rds.h"
+#include "fm_mpx.h"
+#include "modulator.h"
+#include "resampler.h"
+#include "simd.h"
+
+/*
+ * Benchmark
+ *
+ * Times the parts of the signal path that run for every sample, in the
+ * configuration set in the Makefile: the vector kernels against their
+ * plain C versions, the block mixer for each number of streams and the
+ * output resampler.
+ *
+ * The resampler is also measured for quality: a tone goes through and
+ * whatever isn't that tone in the output (images, aliases and noise)
+ * is given against it. Building with BUILTIN_RESAMPLER = 0 gives the
+ * same numbers for libsamplerate.
+ *
+ */
+
+/* samples each kernel goes through in a run */
+#define BENCH_KERNEL_SAMPLES	100000000
+/* samples per call, the size of a block in the mixer */
+#define BENCH_KERNEL_LEN	1024
+
+/* seconds of MPX signal the mixer makes for each number of streams */
+#define BENCH_MIXER_SECONDS	10
+
+/* seconds of each tone that go through the resampler */
+#define BENCH_RESAMPLER_SECONDS	10
+/* output left out of the fit while the filter fills up */
+#define BENCH_RESAMPLER_SKIP	4096
+
+static double get_time() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* keeps the results of the dot products from being thrown away */
+static volatile float sink;
+
+/* ns per sample of one kernel with the kernels selected now */
+static double time_kernel(uint8_t kernel, float *dst, const float *a,
+	const float *b) {
+	uint32_t calls = BENCH_KERNEL_SAMPLES / BENCH_KERNEL_LEN;
+	double start = get_time();
+
+	for (uint32_t n = 0; n < calls; n++) {
+		switch (kernel) {
+		case 0:
+			simd_mac(dst, a, 0.5f, BENCH_KERNEL_LEN);
+			break;
+		case 1:
+			simd_modulate(dst, a, b, 0.5f, BENCH_KERNEL_LEN);
+			break;
+		case 2:
+			simd_clip(dst, a, 0.5f, BENCH_KERNEL_LEN);
+			break;
+		case 3:
+			sink = simd_dot(a, b, BENCH_KERNEL_LEN);
+			break;
+		}
+	}
+
+	return (get_time() - start) * 1e9 / (calls * BENCH_KERNEL_LEN);
+}
+
+static void bench_kernels() {
+	const char *names[] = { "mac", "modulate", "clip", "dot" };
+	float *dst, *a, *b;
+	double scalar, vector;
+
+	dst = alloc_aligned(BENCH_KERNEL_LEN * sizeof(float));
+	a = alloc_aligned(BENCH_KERNEL_LEN * sizeof(float));
+	b = alloc_aligned(BENCH_KERNEL_LEN * sizeof(float));
+	for (uint16_t i = 0; i < BENCH_KERNEL_LEN; i++) {
+		dst[i] = 0.0f;
+		a[i] = sinf(i * 0.01f) * 1.5f;
+		b[i] = cosf(i * 0.03f);
+	}
+
+	set_simd_scalar(false);
+	printf("Kernels (ns per sample, %d at a time)\n", BENCH_KERNEL_LEN);
+	printf("  %-10s %8s %8s %8s\n", "", "scalar", get_simd_name(),
+		"speedup");
+
+	for (uint8_t k = 0; k < 4; k++) {
+		set_simd_scalar(true);
+		scalar = time_kernel(k, dst, a, b);
+		set_simd_scalar(false);
+		vector = time_kernel(k, dst, a, b);
+
+		printf("  %-10s %8.3f %8.3f %7.1fx\n", names[k],
+			scalar, vector, scalar / vector);
+	}
+
+	free(dst);
+	free(a);
+	free(b);
+}
+
+/*
+ * ns per frame of fm_rds_get_frames(), and how much of one core that
+ * takes in real time
+ */
+static void bench_mixer() {
+	struct rds_params_t rds_params = {
+		.ps = "MiniRDS",
+		.rt = "MiniRDS: Software RDS encoder",
+		.pi = 0x1000
+	};
+	uint32_t blocks = BENCH_MIXER_SECONDS * MPX_SAMPLE_RATE
+		/ NUM_MPX_FRAMES_IN;
+	sample_t *buf;
+	double start, ns;
+
+	buf = alloc_aligned(NUM_MPX_FRAMES_IN * sizeof(sample_t));
+
+	fm_mpx_init(MPX_SAMPLE_RATE);
+	set_output_volume(50.0f);
+	init_rds_encoder(rds_params);
+
+#ifdef FIXED_POINT
+	printf("Block mixer at %d Hz (fixed point)\n", MPX_SAMPLE_RATE);
+#else
+	printf("Block mixer at %d Hz (%s kernels)\n", MPX_SAMPLE_RATE,
+		get_simd_name());
+#endif
+	printf("  %-10s %8s %8s\n", "streams", "ns/frame", "% core");
+
+	for (uint8_t streams = 1; streams <= NUM_STREAMS; streams++) {
+#ifdef RDS2
+		set_rds2_streams(streams - 1);
+#endif
+		/* the new streams are set up on the first block */
+		for (uint8_t n = 0; n < 10; n++) {
+			fm_rds_get_frames(buf, NUM_MPX_FRAMES_IN);
+		}
+
+		start = get_time();
+		for (uint32_t n = 0; n < blocks; n++) {
+			fm_rds_get_frames(buf, NUM_MPX_FRAMES_IN);
+		}
+		ns = (get_time() - start) * 1e9 / (blocks * NUM_MPX_FRAMES_IN);
+
+		printf("  %-10d %8.1f %7.1f%%\n", streams, ns,
+			ns * MPX_SAMPLE_RATE * 1e-7);
+	}
+
+	exit_rds_encoder();
+	fm_mpx_exit();
+	free(buf);
+}
+
+#if RDS_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
+/*
+ * Fit a tone of a frequency to a signal (least squares) and give what
+ * is left over against the tone in dB
+ */
+static double get_residual(const float *buf, size_t len, double freq) {
+	double cc = 0.0, ss = 0.0, cs = 0.0, xc = 0.0, xs = 0.0;
+	double w, a, b, det, fit, tone = 0.0, rest = 0.0;
+
+	for (size_t i = 0; i < len; i++) {
+		w = M_2PI * freq * (i % OUTPUT_SAMPLE_RATE) / OUTPUT_SAMPLE_RATE;
+		cc += cos(w) * cos(w);
+		ss += sin(w) * sin(w);
+		cs += cos(w) * sin(w);
+		xc += buf[i] * cos(w);
+		xs += buf[i] * sin(w);
+	}
+
+	det = cc * ss - cs * cs;
+	a = (xc * ss - xs * cs) / det;
+	b = (xs * cc - xc * cs) / det;
+
+	/* a second pass, as the rest can be far below the tone */
+	for (size_t i = 0; i < len; i++) {
+		w = M_2PI * freq * (i % OUTPUT_SAMPLE_RATE) / OUTPUT_SAMPLE_RATE;
+		fit = a * cos(w) + b * sin(w);
+		tone += fit * fit;
+		rest += (buf[i] - fit) * (buf[i] - fit);
+	}
+
+	return 10.0 * log10(rest / tone);
+}
+
+/*
+ * Resample tones from the MPX rate without NATIVE_RATE to the output
+ * rate in blocks the size of a sound card write, like the main loop
+ */
+static void bench_resampler() {
+	/* up to the top of the RDS2 band */
+	const float tones[] = { 1000.0f, 19000.0f, 38000.0f, 57000.0f,
+		76000.0f, 80000.0f };
+	size_t out_len = BENCH_RESAMPLER_SECONDS * OUTPUT_SAMPLE_RATE;
+	struct resampler_t rs;
+	float in[2 * NUM_MPX_FRAMES_OUT];
+	float *out;
+	size_t fill, done, needed, used, frames;
+	uint64_t pos;
+	double start, elapsed = 0.0, worst = -1000.0, residual;
+
+	out = malloc(out_len * sizeof(float));
+
+#ifdef BUILTIN_RESAMPLER
+	printf("Resampler %d -> %d Hz (built-in, quality %d)\n",
+		RDS_SAMPLE_RATE, OUTPUT_SAMPLE_RATE, RESAMPLER_QUALITY);
+#else
+	printf("Resampler %d -> %d Hz (libsamplerate, quality %d)\n",
+		RDS_SAMPLE_RATE, OUTPUT_SAMPLE_RATE, RESAMPLER_QUALITY);
+#endif
+	printf("  %-10s %8s\n", "tone (Hz)", "rest (dB)");
+
+	for (uint8_t t = 0; t < sizeof(tones) / sizeof(float); t++) {
+		if (resampler_init(&rs, RDS_SAMPLE_RATE, OUTPUT_SAMPLE_RATE,
+			1) < 0) break;
+
+		fill = 0;
+		done = 0;
+		pos = 0;
+		while (done < out_len) {
+			frames = out_len - done;
+			if (frames > NUM_MPX_FRAMES_OUT)
+				frames = NUM_MPX_FRAMES_OUT;
+
+			needed = resampler_input_needed(&rs, frames);
+			if (needed > 2 * NUM_MPX_FRAMES_OUT)
+				needed = 2 * NUM_MPX_FRAMES_OUT;
+			while (fill < needed) {
+				in[fill++] = 0.5f * sin(M_2PI * tones[t]
+					* (pos++ % RDS_SAMPLE_RATE)
+					/ RDS_SAMPLE_RATE);
+			}
+
+			start = get_time();
+			if (resample(&rs, in, fill, &used, out + done, frames,
+				&frames) < 0) break;
+			elapsed += get_time() - start;
+
+			fill -= used;
+			memmove(in, in + used, fill * sizeof(float));
+			done += frames;
+		}
+
+		resampler_exit(&rs);
+
+		residual = get_residual(out + BENCH_RESAMPLER_SKIP,
+			done - BENCH_RESAMPLER_SKIP, tones[t]);
+		if (residual > worst) worst = residual;
+		printf("  %-10.0f %8.1f\n", tones[t], residual);
+	}
+
+	elapsed = elapsed * 1e9 / (out_len * (sizeof(tones) / sizeof(float)));
+	printf("  %-10s %8.1f\n", "worst", worst);
+	printf("  %.1f ns per output sample, %.1f%% of one core\n",
+		elapsed, elapsed * OUTPUT_SAMPLE_RATE * 1e-7);
+
+	free(out);
+}
+#endif
+
+int main() {
+	bench_kernels();
+	printf("\n");
+	bench_mixer();
+#if RDS_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
+	printf("\n");
+	bench_resampler();
+#endif
+
+	return 0;
+}
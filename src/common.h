@@ -33,3 +33,37 @@
 #endif
 
 #define M_2PI	(M_PI * 2.0)
+
+/*
+ * Sample format of the signal path
+ *
+ * The fixed point build uses Q15 (32767 is full scale) for boards
+ * without a fast FPU
+ */
+#ifdef FIXED_POINT
+typedef int16_t sample_t;
+#define Q15_ONE			32767
+#define TO_SAMPLE(x)		((sample_t)lrintf((x) * Q15_ONE))
+#define FROM_SAMPLE(x)		((float)(x) / Q15_ONE)
+/* for static initializers (x must not be negative) */
+#define SAMPLE_CONST(x)		((sample_t)((x) * Q15_ONE + 0.5f))
+#else
+typedef float sample_t;
+#define TO_SAMPLE(x)		(x)
+#define FROM_SAMPLE(x)		(x)
+#define SAMPLE_CONST(x)		(x)
+#endif
+
+/* keep hot data on cache lines of its own */
+#define CACHE_LINE_SIZE		64
+
+/*
+ * Allocate a buffer that starts on a cache line
+ *
+ * aligned_alloc needs the size to be a multiple of the alignment, so
+ * it is rounded up
+ */
+static inline void *alloc_aligned(size_t size) {
+	return aligned_alloc(CACHE_LINE_SIZE, (size + CACHE_LINE_SIZE - 1)
+		& ~(size_t)(CACHE_LINE_SIZE - 1));
+}
@@ -0,0 +1,125 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* for clock_gettime */
+#define _POSIX_C_SOURCE 199309L
+
+#include "common.h"
+#include "drift.h"
+
+/*
+ * Sound card clock tracking
+ *
+ * Writes to the sound card block until there is room, so over time the
+ * output goes out exactly as fast as the sound card clock runs. The
+ * output time going by the trimmed sample clock is compared with the
+ * system clock after every write, and a second order loop moves the
+ * trim until the two keep in step. The trim then matches how far the
+ * sound card clock is off.
+ *
+ */
+
+/*
+ * Second order loop with a damping factor of 0.707 and the natural
+ * frequency given as the bandwidth (Hz), starting from a trim
+ *
+ * A timing error of e seconds makes the trim (ppm) move the error by
+ * 1e-6 * ppm seconds every second, hence the scaling of the gains.
+ */
+void drift_init(struct drift_t *drift, uint32_t sample_rate,
+	float bandwidth, float max_ppm, float ppm) {
+	float wn = M_2PI * bandwidth;
+
+	memset(drift, 0, sizeof(struct drift_t));
+	drift->sample_rate = sample_rate;
+	drift->kp = 2.0f * 0.707f * wn * 1e6f;
+	drift->ki = wn * wn * 1e6f;
+	drift->max_ppm = max_ppm;
+	drift->integrator = ppm;
+	drift->ppm = ppm;
+}
+
+static double seconds_since(struct timespec *then) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - then->tv_sec)
+		+ (now.tv_nsec - then->tv_nsec) * 1e-9;
+}
+
+/*
+ * Account for frames that have just been written and update the trim
+ *
+ * Returns the trim (ppm) to apply to the sample clock
+ */
+float drift_update(struct drift_t *drift, size_t frames) {
+	double elapsed, error;
+
+	if (!drift->started) {
+		clock_gettime(CLOCK_MONOTONIC, &drift->start);
+		drift->started = true;
+		return drift->ppm;
+	}
+
+	if (!drift->measuring) {
+		if (seconds_since(&drift->start) < DRIFT_SETTLE_TIME)
+			return drift->ppm;
+
+		/* the device buffers are full, start from here */
+		clock_gettime(CLOCK_MONOTONIC, &drift->start);
+		drift->measuring = true;
+		drift->next_update = DRIFT_UPDATE_TIME;
+		return drift->ppm;
+	}
+
+	elapsed = seconds_since(&drift->start);
+	drift->clock_time += frames /
+		(drift->sample_rate * (1.0 + drift->ppm * 1e-6));
+	drift->error_sum += drift->clock_time - elapsed;
+	drift->error_count++;
+
+	if (elapsed < drift->next_update) return drift->ppm;
+	drift->next_update += DRIFT_UPDATE_TIME;
+
+	/* the average over the update smooths out the write jitter */
+	error = drift->error_sum / drift->error_count;
+	drift->error_sum = 0.0;
+	drift->error_count = 0;
+
+	if (!drift->have_offset) {
+		drift->error_offset = error;
+		drift->have_offset = true;
+		return drift->ppm;
+	}
+	error -= drift->error_offset;
+	drift->error = (float)error;
+
+	/* loop filter */
+	drift->integrator += drift->ki * error * DRIFT_UPDATE_TIME;
+	if (drift->integrator > +drift->max_ppm)
+		drift->integrator = +drift->max_ppm;
+	if (drift->integrator < -drift->max_ppm)
+		drift->integrator = -drift->max_ppm;
+
+	drift->ppm = (float)(drift->integrator + drift->kp * error);
+	if (drift->ppm > +drift->max_ppm) drift->ppm = +drift->max_ppm;
+	if (drift->ppm < -drift->max_ppm) drift->ppm = -drift->max_ppm;
+
+	return drift->ppm;
+}
@@ -0,0 +1,69 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* output let through before measuring, while the device buffers fill up (s) */
+#define DRIFT_SETTLE_TIME	5
+
+/* how often the loop runs (s) */
+#define DRIFT_UPDATE_TIME	10
+
+/*
+ * Loop natural frequency (Hz)
+ *
+ * Slow enough for the timing jitter of the writes to average out,
+ * which makes a change in the clock take several minutes to settle
+ */
+#define DRIFT_BANDWIDTH		0.0005f
+
+/* context for the sound card clock tracking loop */
+typedef struct drift_t {
+	uint32_t sample_rate;
+
+	/* loop filter (proportional and integral gain) */
+	float kp;
+	float ki;
+	double integrator;
+
+	/* largest trim (ppm) */
+	float max_ppm;
+
+	/* when measuring started, or when the first frames were written */
+	struct timespec start;
+	bool started;
+	bool measuring;
+
+	/* time of the output so far going by the trimmed sample clock */
+	double clock_time;
+
+	/* timing error added up since the last update */
+	double error_sum;
+	uint32_t error_count;
+	double next_update;
+
+	/* timing error of the first update, which the loop holds to */
+	double error_offset;
+	bool have_offset;
+
+	/* trim in ppm and the last timing error (s) */
+	float ppm;
+	float error;
+} drift_t;
+
+extern void drift_init(struct drift_t *drift, uint32_t sample_rate,
+	float bandwidth, float max_ppm, float ppm);
+extern float drift_update(struct drift_t *drift, size_t frames);
@@ -0,0 +1,116 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "filter.h"
+
+/*
+ * Audio filters for the stereo encoder
+ *
+ */
+
+/*
+ * Low-pass filter (Blackman windowed sinc)
+ *
+ * The cutoff is the middle of the transition band. The number of taps
+ * comes from the width of the transition band.
+ */
+void lowpass_init(struct lowpass_t *lp, uint32_t sample_rate,
+	float cutoff, float transition) {
+	double fc = cutoff / sample_rate;
+	double center, x, window, sum = 0.0;
+
+	/* a Blackman window needs about 5.5 / transition width taps */
+	lp->taps = (uint16_t)ceil(5.5 * sample_rate / transition) | 1;
+	center = (lp->taps - 1) / 2.0;
+
+	lp->coeffs = malloc(lp->taps * sizeof(float));
+	lp->history = malloc(2 * lp->taps * sizeof(float));
+	memset(lp->history, 0, 2 * lp->taps * sizeof(float));
+	lp->history_pos = 0;
+
+	for (uint16_t i = 0; i < lp->taps; i++) {
+		x = i - center;
+		window = 0.42 - 0.5 * cos(M_2PI * i / (lp->taps - 1))
+			+ 0.08 * cos(2.0 * M_2PI * i / (lp->taps - 1));
+		lp->coeffs[i] = (float)(window * (x == 0.0 ? 2.0 * fc
+			: sin(M_2PI * fc * x) / (M_PI * x)));
+		sum += lp->coeffs[i];
+	}
+
+	/* unity gain at DC */
+	for (uint16_t i = 0; i < lp->taps; i++) {
+		lp->coeffs[i] /= sum;
+	}
+}
+
+float lowpass(struct lowpass_t *lp, float in) {
+	const float *history;
+	float out = 0.0f;
+
+	/* push the new sample */
+	if (lp->history_pos == 0) lp->history_pos = lp->taps;
+	lp->history_pos--;
+	lp->history[lp->history_pos] =
+	lp->history[lp->history_pos + lp->taps] = in;
+
+	history = lp->history + lp->history_pos;
+	for (uint16_t i = 0; i < lp->taps; i++) {
+		out += lp->coeffs[i] * history[i];
+	}
+
+	return out;
+}
+
+void lowpass_exit(struct lowpass_t *lp) {
+	free(lp->coeffs);
+	free(lp->history);
+}
+
+/*
+ * Pre-emphasis
+ *
+ * This is the analog network H(s) = (1 + s * tau) / (1 + s * tau_p)
+ * through the bilinear transform. The zero is prewarped so the corner
+ * frequency lands where it should. The pole is only there to keep the
+ * gain finite and sits above the audio band.
+ */
+void preemphasis_init(struct preemphasis_t *pe, uint32_t sample_rate,
+	float tau_us) {
+	double tau = tau_us * 1e-6;
+	double tau_p = 1.0 / (M_2PI * 0.45 * sample_rate);
+	double fz = 1.0 / (M_2PI * tau);
+	/* prewarped 2 / T */
+	double k = M_2PI * fz / tan(M_PI * fz / sample_rate);
+	double a0 = 1.0 + k * tau_p;
+
+	pe->b0 = (float)((1.0 + k * tau) / a0);
+	pe->b1 = (float)((1.0 - k * tau) / a0);
+	pe->a1 = (float)((1.0 - k * tau_p) / a0);
+	pe->last_in = 0.0f;
+	pe->last_out = 0.0f;
+}
+
+float preemphasis(struct preemphasis_t *pe, float in) {
+	float out = pe->b0 * in + pe->b1 * pe->last_in - pe->a1 * pe->last_out;
+
+	pe->last_in = in;
+	pe->last_out = out;
+
+	return out;
+}
@@ -0,0 +1,45 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* FIR low-pass filter */
+typedef struct lowpass_t {
+	uint16_t taps;
+	float *coeffs;
+
+	/*
+	 * Input history (newest first)
+	 *
+	 * This is stored twice in a row so it can be read linearly
+	 */
+	float *history;
+	uint16_t history_pos;
+} lowpass_t;
+
+/* first order pre-emphasis (high frequency shelf) */
+typedef struct preemphasis_t {
+	float b0, b1, a1;
+	float last_in, last_out;
+} preemphasis_t;
+
+extern void lowpass_init(struct lowpass_t *lp, uint32_t sample_rate,
+	float cutoff, float transition);
+extern float lowpass(struct lowpass_t *lp, float in);
+extern void lowpass_exit(struct lowpass_t *lp);
+extern void preemphasis_init(struct preemphasis_t *pe, uint32_t sample_rate,
+	float tau_us);
+extern float preemphasis(struct preemphasis_t *pe, float in);
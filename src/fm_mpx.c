@@ -23,37 +23,269 @@
 #include "rds2.h"
 #endif
 #include "fm_mpx.h"
+#include "modulator.h"
 #include "osc.h"
+#ifdef RDS_LOW_RATE_ENVELOPE
+#include "interpolator.h"
+#endif
+#ifndef FIXED_POINT
+#include "simd.h"
+#include "limiter.h"
+#endif
+#ifdef STEREO_ENCODER
+#include "audio.h"
+#endif
+#ifdef MPX_INPUT
+#include "pll.h"
+#include "mpx_input.h"
+#endif
 
+#ifdef FIXED_POINT
 /*
- * Local oscillator objects
+ * Mixing is done in Q30 (Q15 * Q15) so a full scale MPX signal still
+ * leaves a bit of headroom in 32 bits
+ */
+typedef int32_t mpx_acc_t;
+#define MPX_ACC_ONE		((int32_t)Q15_ONE << 15)
+
+/* dst += carrier * level */
+static void mix_carrier(mpx_acc_t *dst, const sample_t *carrier,
+	sample_t level, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		dst[i] += (int32_t)carrier[i] * level;
+	}
+}
+
+/*
+ * dst += carrier * envelope * level
+ *
+ * Each shift back down rounds, as a plain shift would always round
+ * towards minus infinity and leave a DC offset in the output
+ */
+static void mix_modulated(mpx_acc_t *dst, const sample_t *carrier,
+	const sample_t *env, sample_t level, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		dst[i] += (((int32_t)carrier[i] * env[i] + (1 << 14)) >> 15)
+			* level;
+	}
+}
+
+/* clip, scale and round back to Q15 */
+static void clip(sample_t *dst, const mpx_acc_t *src,
+	sample_t gain, size_t len) {
+	int32_t sample;
+
+	for (size_t i = 0; i < len; i++) {
+		sample = src[i];
+		if (sample > +MPX_ACC_ONE) sample = +MPX_ACC_ONE;
+		if (sample < -MPX_ACC_ONE) sample = -MPX_ACC_ONE;
+
+		sample = (sample + (1 << 14)) >> 15;
+		sample = (sample * gain + (1 << 14)) >> 15;
+		dst[i] = sample;
+	}
+}
+#else
+typedef float mpx_acc_t;
+
+/* vector kernels */
+#define mix_carrier	simd_mac
+#define mix_modulated	simd_modulate
+#define clip		simd_clip
+#endif
+
+/*
+ * Local oscillator object
  * this is where the MPX waveforms are stored
  *
+ * All carriers are harmonics of a quarter of the pilot frequency and
+ * read from one phase, so they are locked to the pilot by design
+ */
+static struct osc_t osc_mpx;
+
+/* sound card clock trim */
+static float output_ppm;
+static bool auto_ppm;
+
+/* output latency in frames, latest and largest since the last meter read */
+static int32_t output_latency = -1;
+static int32_t max_output_latency = -1;
+
+#define OSC_BASE_FREQ	4750.0f
+#define HARMONIC_19K	4
+#define HARMONIC_38K	8
+#define HARMONIC_57K	12
+#define HARMONIC_67K	14
+#define HARMONIC_71K	15
+#define HARMONIC_76K	16
+
+/* RDS envelope blocks (one after another for each active stream) */
+static sample_t *rds_buffer;
+
+/*
+ * carrier blocks (the pilot, the stereo subcarrier, the quadrature
+ * pilot reference and then one for each active RDS stream)
  */
-static struct osc_t osc_19k;
-static struct osc_t osc_57k;
+static sample_t *carrier_buffer;
+#ifdef STEREO_ENCODER
+#define STEREO_CARRIER	1
+#define NUM_STEREO_CARRIERS	1
+
+/* mid (L+R) and side (L-R) audio at the MPX rate */
+static float *audio_mid;
+static float *audio_side;
+static float audio_vol = 0.8f;
+
+void set_audio_volume(float vol) {
+	if (vol < 0.0f) vol = 0.0f;
+	if (vol > 100.0f) vol = 100.0f;
+	audio_vol = vol / 100.0f;
+}
+#else
+#define NUM_STEREO_CARRIERS	0
+#endif
+
+#ifdef MPX_INPUT
+#define PILOT_Q_CARRIER	(1 + NUM_STEREO_CARRIERS)
+#define NUM_PILOT_Q_CARRIERS	1
+
+/* the pilot of the external MPX signal is tracked by the oscillator */
+static struct pll_t pilot_pll;
+static bool pilot_locked;
+#else
+#define NUM_PILOT_Q_CARRIERS	0
+#endif
+
+#define RDS_CARRIER	(1 + NUM_STEREO_CARRIERS + NUM_PILOT_Q_CARRIERS)
+#define NUM_CARRIERS	(RDS_CARRIER + NUM_STREAMS)
+
 #ifdef RDS2
-static struct osc_t osc_67k;
-static struct osc_t osc_71k;
-static struct osc_t osc_76k;
+/*
+ * RDS2 stream configuration
+ *
+ * This can be changed at any time and is picked up at the start of
+ * the next block
+ */
+static uint8_t rds2_streams = DEFAULT_RDS2_STREAMS;
+static bool rds2_quadrature = DEFAULT_RDS2_QUADRATURE;
+
+void set_rds2_streams(uint8_t streams) {
+	if (streams > NUM_STREAMS - 1) streams = NUM_STREAMS - 1;
+	rds2_streams = streams;
+}
+
+void set_rds2_quadrature(bool quadrature) {
+	rds2_quadrature = quadrature;
+}
 #endif
 
-static float mpx_vol;
+/* streams (including stream 0) and carrier phases in use */
+static uint8_t num_streams;
+static bool quadrature;
+
+/* composite before clipping */
+static mpx_acc_t *mix_buffer;
+
+#ifdef RDS_LOW_RATE_ENVELOPE
+/* envelope interpolators for the active streams (low rate -> MPX rate) */
+static struct interpolator_t rds_interp[NUM_STREAMS];
+static float *rds_env_buffer;
+#endif
+
+static sample_t mpx_vol;
+
+#ifndef FIXED_POINT
+/* composite peak limiter (ahead of the output volume) */
+static struct limiter_t mpx_limiter;
+
+void set_mpx_limiter(float ceiling, float release_ms) {
+	limiter_set(&mpx_limiter, ceiling / 100.0f, release_ms);
+}
+
+void print_mpx_meters() {
+	struct limiter_meters_t meters;
+
+	limiter_get_meters(&mpx_limiter, &meters);
+
+	fprintf(stderr, "MPX peak %.1f%%, RMS %.1f%%, "
+		"gain reduction %.2f dB, %u samples over the ceiling\n",
+		meters.peak * 100.0f, meters.rms * 100.0f,
+		-20.0f * log10f(meters.min_gain), meters.limited);
+	fprintf(stderr, "Sound card clock trim %.2f ppm%s\n",
+		output_ppm, auto_ppm ? " (automatic)" : "");
+	if (output_latency >= 0) {
+		fprintf(stderr, "Output latency %.1f ms (up to %.1f ms)\n",
+			output_latency * 1000.0f / OUTPUT_SAMPLE_RATE,
+			max_output_latency * 1000.0f / OUTPUT_SAMPLE_RATE);
+		max_output_latency = output_latency;
+	}
+}
+#endif
 
 void set_output_volume(float vol) {
 	if (vol > 100.0f) vol = 100.0f;
-	mpx_vol = vol / 100.0f;
+	mpx_vol = TO_SAMPLE(vol / 100.0f);
+}
+
+/*
+ * Trim for a sound card clock that is off by ppm parts per million
+ *
+ * When the MPX signal is generated at the output rate the oscillator
+ * is trimmed, which keeps the carriers on frequency, and so are the
+ * envelope interpolators of a low rate envelope, which keeps the RDS
+ * bit rate at 1/48 of the 57 kHz carrier. Otherwise the main loop
+ * trims the ratio of the output resampler, which keeps the whole MPX
+ * signal (RDS bit rate included) on time.
+ *
+ * The premodulated RDS carrier is fixed in its table, so with it the
+ * pilot is left untrimmed as well, to keep the 57 kHz at three times
+ * the pilot phase.
+ */
+void set_output_ppm(float ppm) {
+	if (ppm > +MAX_OUTPUT_PPM) ppm = +MAX_OUTPUT_PPM;
+	if (ppm < -MAX_OUTPUT_PPM) ppm = -MAX_OUTPUT_PPM;
+	output_ppm = ppm;
+#if MPX_SAMPLE_RATE == OUTPUT_SAMPLE_RATE && !defined(RDS_PREMODULATED)
+	osc_set_ppm(&osc_mpx, ppm);
+#ifdef RDS_LOW_RATE_ENVELOPE
+	for (uint8_t i = 0; i < num_streams; i++) {
+		interpolator_set_ppm(&rds_interp[i], ppm);
+	}
+#endif
+#endif
+}
+
+float get_output_ppm() {
+	return output_ppm;
+}
+
+/*
+ * Let the main loop measure the sound card clock and set the trim
+ *
+ */
+void set_auto_ppm(bool on) {
+	auto_ppm = on;
+}
+
+bool get_auto_ppm() {
+	return auto_ppm;
+}
+
+/* frames queued in the output after the last write (-1 if unknown) */
+void set_output_latency(int32_t frames) {
+	output_latency = frames;
+	if (frames > max_output_latency) max_output_latency = frames;
 }
 
 /* subcarrier volumes */
-static float volumes[MPX_SUBCARRIER_END] = {
-	0.09f, /* pilot tone: 9% */
-	0.09f, /* RDS: 4.5% modulation */
+static sample_t volumes[MPX_SUBCARRIER_END] = {
+	SAMPLE_CONST(0.09f), /* pilot tone: 9% */
+	SAMPLE_CONST(0.09f), /* RDS: 4.5% modulation */
 #ifdef RDS2
 	/* RDS2 */
-	0.093333f,
-	0.095f,
-	0.096667f
+	SAMPLE_CONST(0.093333f),
+	SAMPLE_CONST(0.095f),
+	SAMPLE_CONST(0.096667f)
 #endif
 };
 
@@ -64,93 +296,329 @@ void set_carrier_volume(uint8_t carrier, float new_volume) {
 	/* don't allow levels over 15% */
 	if (new_volume >= 15.0f) new_volume = 15.0f;
 
-	volumes[carrier] = new_volume / 100.0f;
+	volumes[carrier] = TO_SAMPLE(new_volume / 100.0f);
 }
 
 void fm_mpx_init(uint32_t sample_rate) {
-	/* initialize the subcarrier oscillators */
-	osc_init(&osc_19k, sample_rate, 19000.0f);
-	osc_init(&osc_57k, sample_rate, 57000.0f);
+	/* initialize the subcarrier oscillator */
+	osc_init(&osc_mpx, sample_rate, OSC_BASE_FREQ);
+
+	/* the RDS and carrier blocks depend on the stream configuration */
+	mix_buffer = alloc_aligned(NUM_MPX_FRAMES_IN * sizeof(mpx_acc_t));
+#ifdef STEREO_ENCODER
+	audio_mid = alloc_aligned(NUM_MPX_FRAMES_IN * sizeof(float));
+	audio_side = alloc_aligned(NUM_MPX_FRAMES_IN * sizeof(float));
+#endif
+
+#ifndef FIXED_POINT
+	init_simd();
+	limiter_init(&mpx_limiter, sample_rate, NUM_MPX_FRAMES_IN);
+#endif
+
+#ifdef MPX_INPUT
+	pll_init(&pilot_pll, sample_rate,
+		PILOT_PLL_BANDWIDTH, PILOT_PLL_MAX_OFFSET);
+#endif
+}
+
+/*
+ * Fill the carrier blocks
+ *
+ * Carriers that are phase shifted for RDS2 are stored that way so the
+ * mixer only has to multiply and add. Carriers of streams that are off
+ * aren't generated at all.
+ */
+static inline void fill_carriers(sample_t **carrier, size_t num_frames,
+	const uint8_t streams, const bool quad) {
+#ifdef STEREO_ENCODER
+	bool stereo = audio_input_active();
+#endif
+#ifdef MPX_INPUT
+	bool mpx_in = mpx_input_active();
+#endif
+	sample_t **rds_carrier = carrier + RDS_CARRIER;
+#ifndef RDS2
+	(void)streams;
+	(void)quad;
+#endif
+
+	for (size_t k = 0; k < num_frames; k++) {
+		/* Pilot tone for calibration */
+		carrier[0][k] = osc_get_cos(&osc_mpx, HARMONIC_19K);
+
+#ifdef MPX_INPUT
+		/* to measure the phase of an incoming pilot */
+		if (mpx_in) {
+			carrier[PILOT_Q_CARRIER][k] =
+				-osc_get_sin(&osc_mpx, HARMONIC_19K);
+		}
+#endif
+
+#ifdef STEREO_ENCODER
+		/* crosses zero together with the pilot */
+		if (stereo) {
+			carrier[STEREO_CARRIER][k] =
+				-osc_get_sin(&osc_mpx, HARMONIC_38K);
+		}
+#endif
+
+#ifndef RDS_PREMODULATED
+		rds_carrier[0][k] = osc_get_cos(&osc_mpx, HARMONIC_57K);
+#endif
 #ifdef RDS2
-	osc_init(&osc_67k, sample_rate, 66500.0f);
-	osc_init(&osc_71k, sample_rate, 71250.0f);
-	osc_init(&osc_76k, sample_rate, 76000.0f);
+		/*
+		 * In quadrature the streams are shifted by 90, 180 and
+		 * 270 degrees
+		 */
+		if (streams > 1) {
+			rds_carrier[1][k] = quad ?
+				+osc_get_sin(&osc_mpx, HARMONIC_67K) :
+				+osc_get_cos(&osc_mpx, HARMONIC_67K);
+		}
+		if (streams > 2) {
+			rds_carrier[2][k] = quad ?
+				-osc_get_cos(&osc_mpx, HARMONIC_71K) :
+				+osc_get_cos(&osc_mpx, HARMONIC_71K);
+		}
+		if (streams > 3) {
+			rds_carrier[3][k] = quad ?
+				-osc_get_sin(&osc_mpx, HARMONIC_76K) :
+				+osc_get_cos(&osc_mpx, HARMONIC_76K);
+		}
 #endif
+
+		/* update oscillator */
+		osc_update_pos(&osc_mpx);
+	}
 }
 
-void fm_rds_get_frames(float *outbuf, size_t num_frames) {
-	size_t j = 0;
-	float out;
+/* one carrier kernel for every stream configuration */
+typedef void (*carrier_kernel_t)(sample_t **carrier, size_t num_frames);
 
-	for (size_t i = 0; i < num_frames; i++) {
-		out = 0.0f;
+#define CARRIER_KERNEL(name, streams, quad) \
+	static void name(sample_t **carrier, size_t num_frames) { \
+		fill_carriers(carrier, num_frames, streams, quad); \
+	}
 
-		/* Pilot tone for calibration */
-		out += osc_get_cos(&osc_19k)
-			* volumes[MPX_SUBCARRIER_ST_PILOT];
+CARRIER_KERNEL(get_carriers_1, 1, false)
+#ifdef RDS2
+CARRIER_KERNEL(get_carriers_2, 2, false)
+CARRIER_KERNEL(get_carriers_3, 3, false)
+CARRIER_KERNEL(get_carriers_4, 4, false)
+CARRIER_KERNEL(get_carriers_2q, 2, true)
+CARRIER_KERNEL(get_carriers_3q, 3, true)
+CARRIER_KERNEL(get_carriers_4q, 4, true)
+#endif
 
-		out += osc_get_cos(&osc_57k)
-			* get_rds_sample(0)
-			* volumes[MPX_SUBCARRIER_RDS_STREAM_0];
+static const carrier_kernel_t carrier_kernels[2][NUM_STREAMS] = {
 #ifdef RDS2
-#ifdef RDS2_QUADRATURE_CARRIER
-		/* RDS2 is quadrature phase */
-
-		/* 90 degree shift */
-		out += osc_get_sin(&osc_67k)
-			* get_rds_sample(1)
-			* volumes[MPX_SUBCARRIER_RDS2_STREAM_1];
-
-		/* 180 degree shift */
-		out += -osc_get_cos(&osc_71k)
-			* get_rds_sample(2)
-			* volumes[MPX_SUBCARRIER_RDS2_STREAM_2];
-
-		/* 270 degree shift */
-		out += -osc_get_sin(&osc_76k)
-			* get_rds_sample(3)
-			* volumes[MPX_SUBCARRIER_RDS2_STREAM_3];
+	{ get_carriers_1, get_carriers_2, get_carriers_3, get_carriers_4 },
+	{ get_carriers_1, get_carriers_2q, get_carriers_3q, get_carriers_4q }
 #else
-		out += osc_get_cos(&osc_67k)
-			* get_rds_sample(1)
-			* volumes[MPX_SUBCARRIER_RDS2_STREAM_1];
+	{ get_carriers_1 },
+	{ get_carriers_1 }
+#endif
+};
+
+static carrier_kernel_t get_carriers;
 
-		out += osc_get_cos(&osc_71k)
-			* get_rds_sample(2)
-			* volumes[MPX_SUBCARRIER_RDS2_STREAM_2];
+/*
+ * Switch to the requested stream configuration
+ *
+ * Only the active streams get envelope and carrier blocks
+ */
+static void update_stream_config() {
+	uint8_t streams = 1;
+	bool quad = false;
 
-		out += osc_get_cos(&osc_76k)
-			* get_rds_sample(3)
-			* volumes[MPX_SUBCARRIER_RDS2_STREAM_3];
+#ifdef RDS2
+	streams += rds2_streams;
+	quad = rds2_quadrature;
 #endif
+
+	if (streams == num_streams && quad == quadrature) return;
+
+	if (streams != num_streams) {
+		free(rds_buffer);
+		free(carrier_buffer);
+		rds_buffer = alloc_aligned(streams * NUM_MPX_FRAMES_IN
+			* sizeof(sample_t));
+		carrier_buffer = alloc_aligned((RDS_CARRIER + streams)
+			* NUM_MPX_FRAMES_IN * sizeof(sample_t));
+
+#ifdef RDS_LOW_RATE_ENVELOPE
+		for (uint8_t i = streams; i < num_streams; i++) {
+			interpolator_exit(&rds_interp[i]);
+		}
+		for (uint8_t i = num_streams; i < streams; i++) {
+			interpolator_init(&rds_interp[i], ENV_SAMPLE_RATE,
+				MPX_SAMPLE_RATE, ENV_INTERP_TAPS);
+
+			/* all streams take in their samples together */
+			if (i > 0)
+				interpolator_sync(&rds_interp[i], &rds_interp[0]);
+#if MPX_SAMPLE_RATE == OUTPUT_SAMPLE_RATE
+			else
+				interpolator_set_ppm(&rds_interp[0], output_ppm);
 #endif
+		}
+
+		/* the low rate envelopes are generated here first */
+		free(rds_env_buffer);
+		rds_env_buffer = alloc_aligned(streams * NUM_MPX_FRAMES_IN
+			* sizeof(float));
+#endif
+
+		set_rds_streams(streams);
+	}
+
+	num_streams = streams;
+	quadrature = quad;
+	get_carriers = carrier_kernels[quad][streams - 1];
 
-		/* update oscillator */
-		osc_update_pos(&osc_19k);
-		osc_update_pos(&osc_57k);
 #ifdef RDS2
-		osc_update_pos(&osc_67k);
-		osc_update_pos(&osc_71k);
-		osc_update_pos(&osc_76k);
+	fprintf(stderr, "Sending %u RDS2 stream(s)%s.\n", streams - 1,
+		streams > 1 && quad ? " in quadrature" : "");
 #endif
+}
 
-		/* clipper */
-		out = fminf(+1.0f, out);
-		out = fmaxf(-1.0f, out);
+#ifdef MPX_INPUT
+/*
+ * Pull the oscillator onto the pilot of the external MPX signal
+ *
+ * The correction is applied from the next block on
+ */
+static void track_pilot(const float *in, sample_t **carrier,
+	size_t num_frames) {
+	float offset;
 
-		/* adjust volume and put into both channels */
-		outbuf[j+0] = outbuf[j+1] = out * mpx_vol;
-		j += 2;
+	offset = pll_update(&pilot_pll, in, carrier[0],
+		carrier[PILOT_Q_CARRIER], num_frames);
+	osc_set_freq(&osc_mpx, OSC_BASE_FREQ + offset / HARMONIC_19K);
 
+	if (pilot_pll.locked != pilot_locked) {
+		pilot_locked = pilot_pll.locked;
+		if (pilot_locked) {
+			fprintf(stderr, "Locked to the input pilot "
+				"(%+.3f Hz).\n", offset);
+		} else if (pilot_pll.level < PLL_MIN_LEVEL) {
+			fprintf(stderr, "No pilot in the MPX input.\n");
+		} else {
+			fprintf(stderr, "Lost the input pilot.\n");
+		}
 	}
 }
+#endif
 
-void fm_mpx_exit() {
-	osc_exit(&osc_19k);
-	osc_exit(&osc_57k);
+void fm_rds_get_frames(sample_t *outbuf, size_t num_frames) {
+	size_t block_frames;
+#ifdef RDS_LOW_RATE_ENVELOPE
+	size_t env_frames;
+#endif
+	sample_t *rds_env[NUM_STREAMS] = { NULL };
+	sample_t *carrier[NUM_CARRIERS];
+
+	update_stream_config();
+
+	for (size_t i = 0; i < num_frames; i += block_frames) {
+		block_frames = num_frames - i;
+		if (block_frames > NUM_MPX_FRAMES_IN)
+			block_frames = NUM_MPX_FRAMES_IN;
+
+		/* generate the envelopes for this block */
+#ifdef RDS_LOW_RATE_ENVELOPE
+		/* all streams are in lockstep so they need the same amount */
+		env_frames = interpolator_input_needed(&rds_interp[0],
+			block_frames);
+		get_rds_samples(rds_env_buffer, env_frames);
+		for (uint8_t k = 0; k < num_streams; k++) {
+			rds_env[k] = rds_buffer + k * block_frames;
+			interpolate(&rds_interp[k],
+				rds_env_buffer + k * env_frames,
+				rds_env[k], block_frames);
+		}
+#else
+		get_rds_samples(rds_buffer, block_frames);
+		for (uint8_t k = 0; k < num_streams; k++) {
+			rds_env[k] = rds_buffer + k * block_frames;
+		}
+#endif
+
+		for (uint8_t k = 0; k < RDS_CARRIER + num_streams; k++) {
+			carrier[k] = carrier_buffer + k * block_frames;
+		}
+		get_carriers(carrier, block_frames);
+
+		/* mix everything together */
+#ifdef MPX_INPUT
+		if (mpx_input_active()) {
+			/* on top of the external signal and its pilot */
+			get_mpx_input_samples(mix_buffer, block_frames);
+			track_pilot(mix_buffer, carrier, block_frames);
+		} else
+#endif
+		{
+			memset(mix_buffer, 0, block_frames * sizeof(mpx_acc_t));
+
+			mix_carrier(mix_buffer, carrier[0],
+				volumes[MPX_SUBCARRIER_ST_PILOT], block_frames);
+		}
+
+#ifdef RDS_PREMODULATED
+		/* already on the carrier */
+		mix_carrier(mix_buffer, rds_env[0],
+			volumes[MPX_SUBCARRIER_RDS_STREAM_0], block_frames);
+#else
+		mix_modulated(mix_buffer, carrier[RDS_CARRIER], rds_env[0],
+			volumes[MPX_SUBCARRIER_RDS_STREAM_0], block_frames);
+#endif
 #ifdef RDS2
-	osc_exit(&osc_67k);
-	osc_exit(&osc_71k);
-	osc_exit(&osc_76k);
+		for (uint8_t k = 1; k < num_streams; k++) {
+			mix_modulated(mix_buffer, carrier[RDS_CARRIER + k],
+				rds_env[k],
+				volumes[MPX_SUBCARRIER_RDS_STREAM_0 + k],
+				block_frames);
+		}
+#endif
+
+#ifdef STEREO_ENCODER
+		if (audio_input_active()) {
+			get_audio_samples(audio_mid, audio_side, block_frames);
+			mix_carrier(mix_buffer, audio_mid, audio_vol,
+				block_frames);
+			mix_modulated(mix_buffer, carrier[STEREO_CARRIER],
+				audio_side, audio_vol, block_frames);
+		}
+#endif
+
+#ifndef FIXED_POINT
+		/* take the peaks down before they hit the clipper */
+		limiter_process(&mpx_limiter, mix_buffer, block_frames);
+#endif
+
+		/* clipper and volume */
+		clip(outbuf + i, mix_buffer, mpx_vol, block_frames);
+	}
+}
+
+void fm_mpx_exit() {
+	osc_exit(&osc_mpx);
+#ifndef FIXED_POINT
+	limiter_exit(&mpx_limiter);
+#endif
+
+	free(rds_buffer);
+	free(carrier_buffer);
+	free(mix_buffer);
+#ifdef STEREO_ENCODER
+	free(audio_mid);
+	free(audio_side);
+#endif
+
+#ifdef RDS_LOW_RATE_ENVELOPE
+	for (uint8_t i = 0; i < num_streams; i++) {
+		interpolator_exit(&rds_interp[i]);
+	}
+	free(rds_env_buffer);
 #endif
 }
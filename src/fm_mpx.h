@@ -18,14 +18,70 @@
 
 /* MPX */
 #define NUM_MPX_FRAMES_IN	1024
-#define NUM_MPX_FRAMES_OUT	(NUM_MPX_FRAMES_IN * 2)
+/* frames written to the sound card at a time */
+#define NUM_MPX_FRAMES_OUT	NUM_MPX_FRAMES_IN
+
+/*
+ * The sample rate of the sound card
+ *
+ * When this is the same as the MPX rate, no resampling is done
+ */
+#ifndef OUTPUT_SAMPLE_RATE
+#define OUTPUT_SAMPLE_RATE	192000
+#endif
 
 /*
  * The sample rate at which the MPX generation runs at
+ *
+ * At the native rate this is the sound card rate and only the RDS
+ * envelope runs at a rate that is tied to the bit rate
  */
+#ifdef NATIVE_RATE
+#define MPX_SAMPLE_RATE		OUTPUT_SAMPLE_RATE
+#else
 #define MPX_SAMPLE_RATE		RDS_SAMPLE_RATE
+#endif
 
-#define OUTPUT_SAMPLE_RATE	192000
+/*
+ * The MPX signal is mono up to the sound card, where it goes out on all
+ * of its channels
+ */
+#define OUTPUT_CHANNELS		2
+
+#if defined(FIXED_POINT) && defined(STEREO_ENCODER)
+#error "The stereo encoder needs the floating point build"
+#endif
+
+#if defined(FIXED_POINT) && defined(MPX_INPUT)
+#error "MPX input needs the floating point build"
+#endif
+
+/*
+ * The premodulated table carries its own 57 kHz, which can't follow
+ * the pilot of an external MPX signal
+ */
+#if defined(RDS_PREMODULATED) && defined(MPX_INPUT)
+#error "MPX input needs the RDS carrier from the oscillator, set RDS_PREMODULATED to 0"
+#endif
+
+#if defined(FIXED_POINT) && MPX_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
+#error "FIXED_POINT has no resampler, set OUTPUT_SAMPLE_RATE to RDS_SAMPLE_RATE"
+#endif
+
+/* largest sound card clock trim (ppm) */
+#define MAX_OUTPUT_PPM		500.0f
+
+#ifdef RDS2
+/* RDS2 streams sent next to stream 0 unless told otherwise (0-3) */
+#define DEFAULT_RDS2_STREAMS	3
+
+/* carrier phases of the RDS2 streams at startup */
+#ifdef RDS2_QUADRATURE_CARRIER
+#define DEFAULT_RDS2_QUADRATURE	true
+#else
+#define DEFAULT_RDS2_QUADRATURE	false
+#endif
+#endif
 
 enum mpx_subcarriers {
 	MPX_SUBCARRIER_ST_PILOT,
@@ -39,7 +95,23 @@ enum mpx_subcarriers {
 };
 
 extern void fm_mpx_init(uint32_t sample_rate);
-extern void fm_rds_get_frames(float *outbuf, size_t num_frames);
+extern void fm_rds_get_frames(sample_t *outbuf, size_t num_frames);
 extern void fm_mpx_exit();
 extern void set_output_volume(float vol);
 extern void set_carrier_volume(uint8_t carrier, float new_volume);
+extern void set_output_ppm(float ppm);
+extern float get_output_ppm();
+extern void set_auto_ppm(bool on);
+extern bool get_auto_ppm();
+extern void set_output_latency(int32_t frames);
+#ifdef RDS2
+extern void set_rds2_streams(uint8_t streams);
+extern void set_rds2_quadrature(bool quadrature);
+#endif
+#ifndef FIXED_POINT
+extern void set_mpx_limiter(float ceiling, float release_ms);
+extern void print_mpx_meters();
+#endif
+#ifdef STEREO_ENCODER
+extern void set_audio_volume(float vol);
+#endif
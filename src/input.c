@@ -0,0 +1,202 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "input.h"
+#ifdef ALSA_INPUT
+#include <alsa/asoundlib.h>
+#endif
+
+/*
+ * Sample input shared by the stereo encoder and the MPX input
+ *
+ * Samples are 16-bit little endian from a WAV or raw file, stdin or an
+ * ALSA capture device.
+ *
+ */
+
+/*
+ * Read the format from a WAV header and skip to the sample data
+ *
+ * Only 16-bit PCM is supported
+ */
+static int8_t read_wav_header(struct input_t *in) {
+	uint8_t hdr[16];
+	uint32_t chunk_size;
+	uint16_t format = 0, bits = 0;
+
+	/* "RIFF", size, "WAVE" have been read already */
+	while (fread(hdr, 1, 8, in->file) == 8) {
+		chunk_size = hdr[4] | hdr[5] << 8 | hdr[6] << 16 |
+			(uint32_t)hdr[7] << 24;
+
+		if (memcmp(hdr, "fmt ", 4) == 0) {
+			if (chunk_size < 16 || fread(hdr, 1, 16, in->file) != 16)
+				break;
+			format = hdr[0] | hdr[1] << 8;
+			in->channels = hdr[2];
+			in->rate = hdr[4] | hdr[5] << 8 | hdr[6] << 16 |
+				(uint32_t)hdr[7] << 24;
+			bits = hdr[14] | hdr[15] << 8;
+			chunk_size -= 16;
+		} else if (memcmp(hdr, "data", 4) == 0) {
+			if (format != 1 || bits != 16 ||
+				in->channels < 1 || in->channels > 2) {
+				fprintf(stderr, "Error: only 16-bit PCM "
+					"mono or stereo WAV files are "
+					"supported.\n");
+				return -1;
+			}
+			return 0;
+		}
+
+		/* chunks are padded to an even size */
+		if (fseek(in->file, chunk_size + (chunk_size & 1), SEEK_CUR) < 0)
+			break;
+	}
+
+	fprintf(stderr, "Error: invalid WAV file.\n");
+	return -1;
+}
+
+static int8_t open_file(struct input_t *in) {
+	uint8_t hdr[12];
+
+	if (strcmp(in->name, "-") == 0) {
+		/* raw samples */
+		in->file = stdin;
+		return 0;
+	}
+
+	in->file = fopen(in->name, "rb");
+	if (in->file == NULL) {
+		fprintf(stderr, "Error: could not open %s.\n", in->name);
+		return -1;
+	}
+
+	if (fread(hdr, 1, 12, in->file) == 12 &&
+		memcmp(hdr, "RIFF", 4) == 0 && memcmp(hdr + 8, "WAVE", 4) == 0)
+		return read_wav_header(in);
+
+	/* no header, so it is raw */
+	rewind(in->file);
+	return 0;
+}
+
+#ifdef ALSA_INPUT
+static int8_t open_alsa(struct input_t *in, char *device) {
+	snd_pcm_t *pcm;
+	int err;
+
+	err = snd_pcm_open(&pcm, device, SND_PCM_STREAM_CAPTURE, 0);
+	if (err < 0) {
+		fprintf(stderr, "Error: could not open %s: %s\n",
+			device, snd_strerror(err));
+		return -1;
+	}
+
+	/* half a second of buffering */
+	err = snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE,
+		SND_PCM_ACCESS_RW_INTERLEAVED, in->channels, in->rate,
+		1, 500000);
+	if (err < 0) {
+		fprintf(stderr, "Error: could not set up %s: %s\n",
+			device, snd_strerror(err));
+		snd_pcm_close(pcm);
+		return -1;
+	}
+
+	in->pcm = pcm;
+	return 0;
+}
+#endif
+
+/*
+ * Open a sample source
+ *
+ * "-" is stdin, "alsa:<device>" is an ALSA capture device and anything
+ * else is a file. The rate and channel count are only used for raw
+ * samples and ALSA, WAV files bring their own.
+ */
+int8_t open_input(struct input_t *in, char *name, uint32_t rate,
+	uint8_t channels) {
+	memset(in, 0, sizeof(struct input_t));
+	in->name = name;
+	in->rate = rate;
+	in->channels = channels;
+
+	if (strncmp(name, "alsa:", 5) == 0) {
+#ifdef ALSA_INPUT
+		return open_alsa(in, name + 5);
+#else
+		fprintf(stderr, "Error: ALSA input is not enabled.\n");
+		return -1;
+#endif
+	}
+
+	return open_file(in);
+}
+
+/*
+ * Read a number of frames
+ *
+ * Whatever could not be read is silence
+ */
+void read_input(struct input_t *in, int16_t *buf, size_t num_frames) {
+	size_t frames = 0;
+#ifdef ALSA_INPUT
+	snd_pcm_sframes_t r;
+
+	if (in->pcm) {
+		while (frames < num_frames) {
+			r = snd_pcm_readi(in->pcm, buf + frames * in->channels,
+				num_frames - frames);
+			if (r < 0) {
+				/* overrun */
+				if (snd_pcm_recover(in->pcm, r, 1) < 0) break;
+				continue;
+			}
+			frames += r;
+		}
+	} else
+#endif
+	{
+		frames = fread(buf, in->channels * sizeof(int16_t),
+			num_frames, in->file);
+	}
+
+	if (frames < num_frames) {
+		if (!in->warned_eof) {
+			fprintf(stderr, "End of input from %s.\n", in->name);
+			in->warned_eof = true;
+		}
+		memset(buf + frames * in->channels, 0,
+			(num_frames - frames) * in->channels * sizeof(int16_t));
+	}
+}
+
+void close_input(struct input_t *in) {
+#ifdef ALSA_INPUT
+	if (in->pcm) {
+		snd_pcm_close(in->pcm);
+		in->pcm = NULL;
+	}
+#endif
+	if (in->file && in->file != stdin) fclose(in->file);
+	in->file = NULL;
+}
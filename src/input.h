@@ -0,0 +1,35 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* sample source (WAV or raw file, stdin or ALSA capture device) */
+typedef struct input_t {
+	char *name;
+	FILE *file;
+
+	/* capture device (snd_pcm_t, only with ALSA_INPUT) */
+	void *pcm;
+
+	uint8_t channels;
+	uint32_t rate;
+	bool warned_eof;
+} input_t;
+
+extern int8_t open_input(struct input_t *in, char *name, uint32_t rate,
+	uint8_t channels);
+extern void read_input(struct input_t *in, int16_t *buf, size_t num_frames);
+extern void close_input(struct input_t *in);
@@ -0,0 +1,218 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "interpolator.h"
+#include "simd.h"
+
+/*
+ * Polyphase interpolator
+ *
+ * Raises the sample rate of a band-limited signal by a rational factor.
+ * Only the filter phase that lands on each output sample is computed,
+ * so the zeros that upsampling would insert never get multiplied and
+ * the samples that decimation would throw away are never made.
+ *
+ */
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+	uint32_t t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/*
+ * Design the prototype low-pass filter (Blackman windowed sinc) with
+ * its cutoff at the input Nyquist frequency and split it into phases
+ *
+ * Output sample n of every cycle of output samples uses phase
+ * n * decimation % phases, so that is the order they are stored in
+ */
+static void design_filter(struct interpolator_t *interp) {
+	uint32_t len = (uint32_t)interp->phases * interp->taps;
+	double center = (len - 1) / 2.0;
+	double x, window, sinc;
+	uint32_t i;
+	uint16_t phase = 0;
+
+	for (uint16_t n = 0; n < interp->phases; n++) {
+		for (uint8_t t = 0; t < interp->taps; t++) {
+			/* tap t of a phase is sample t * phases + phase */
+			i = (uint32_t)t * interp->phases + phase;
+			x = (i - center) / interp->phases;
+			sinc = x == 0.0 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+			window = 0.42 - 0.5 * cos(M_2PI * i / (len - 1))
+				+ 0.08 * cos(2.0 * M_2PI * i / (len - 1));
+
+			interp->coeffs[t * interp->phases + n] =
+				(float)(sinc * window);
+		}
+
+		phase = (phase + interp->decimation) % interp->phases;
+	}
+}
+
+void interpolator_init(struct interpolator_t *interp,
+	uint32_t in_rate, uint32_t out_rate, uint8_t taps) {
+	uint32_t div = gcd(in_rate, out_rate);
+
+	interp->phases = out_rate / div;
+	interp->decimation = in_rate / div;
+	interp->taps = taps;
+
+	interp->coeffs = malloc((size_t)interp->phases * taps * sizeof(float));
+	interp->history = malloc(2 * taps * sizeof(float));
+	memset(interp->history, 0, 2 * taps * sizeof(float));
+
+	interp->history_pos = 0;
+	interp->phase = 0;
+	interp->row_pos = 0;
+
+	/* the row that is one phase on from the first one */
+	interp->unit_row = 0;
+	for (uint16_t n = 0; n < interp->phases; n++) {
+		if ((uint32_t)n * interp->decimation % interp->phases == 1) {
+			interp->unit_row = n;
+			break;
+		}
+	}
+
+	interp->trim_step = 0.0f;
+	interp->trim_acc = 0.0f;
+
+	design_filter(interp);
+	init_simd();
+}
+
+/*
+ * Start from the same point in time as another interpolator with the
+ * same rates, so both need the same input from now on
+ */
+void interpolator_sync(struct interpolator_t *interp,
+	const struct interpolator_t *ref) {
+	interp->phase = ref->phase;
+	interp->row_pos = ref->row_pos;
+	interp->trim_step = ref->trim_step;
+	interp->trim_acc = ref->trim_acc;
+}
+
+/*
+ * Trim for an output sample clock that is off by ppm parts per million
+ *
+ * A positive value means the output clock runs fast, so every output
+ * sample moves on a little less through the input
+ */
+void interpolator_set_ppm(struct interpolator_t *interp, float ppm) {
+	interp->trim_step = interp->decimation
+		* (1.0 / (1.0 + ppm * 1e-6) - 1.0);
+}
+
+/*
+ * Move the phase on by the whole phases the trim has built up
+ *
+ * This is only done where it doesn't change when the next input sample
+ * is taken in, otherwise it waits for a later call. Being done at the
+ * end of a call keeps interpolator_input_needed() exact.
+ */
+static void apply_trim(struct interpolator_t *interp) {
+	int32_t shift = (int32_t)interp->trim_acc;
+	int32_t phase = interp->phase + shift;
+	uint32_t rows;
+
+	if (shift == 0) return;
+	if (phase < 0 || phase >= interp->phases) return;
+	if ((phase < interp->decimation) !=
+		(interp->phase < interp->decimation)) return;
+
+	rows = (uint32_t)(shift + interp->phases) % interp->phases;
+	interp->phase = phase;
+	interp->row_pos = (interp->row_pos
+		+ rows * interp->unit_row) % interp->phases;
+	interp->trim_acc -= shift;
+}
+
+/*
+ * How many input samples are needed to generate a number of
+ * output samples
+ *
+ * A new input sample is taken in every time the phase wraps around,
+ * which is when it falls below the decimation factor
+ */
+size_t interpolator_input_needed(struct interpolator_t *interp,
+	size_t num_frames) {
+	if (num_frames == 0) return 0;
+
+	return (interp->phase < interp->decimation ? 1 : 0) +
+		(interp->phase + (num_frames - 1) * interp->decimation)
+		/ interp->phases;
+}
+
+void interpolate(struct interpolator_t *interp,
+	const float *in, float *out, size_t num_frames) {
+	const float *coeffs;
+	size_t run;
+
+	interp->trim_acc += num_frames * interp->trim_step;
+
+	while (num_frames) {
+		if (interp->phase < interp->decimation) {
+			/* push the next input sample */
+			if (interp->history_pos == 0)
+				interp->history_pos = interp->taps;
+			interp->history_pos--;
+			interp->history[interp->history_pos] =
+			interp->history[interp->history_pos + interp->taps] =
+				*in++;
+		}
+
+		/* output samples left before the next input sample */
+		run = (interp->phases - interp->phase
+			+ interp->decimation - 1) / interp->decimation;
+		if (run > num_frames) run = num_frames;
+
+		memset(out, 0, run * sizeof(float));
+
+		coeffs = interp->coeffs + interp->row_pos;
+		for (uint8_t j = 0; j < interp->taps; j++) {
+			simd_mac(out, coeffs,
+				interp->history[interp->history_pos + j],
+				run);
+			coeffs += interp->phases;
+		}
+
+		out += run;
+		num_frames -= run;
+		interp->row_pos += run;
+		if (interp->row_pos == interp->phases) interp->row_pos = 0;
+		interp->phase = (interp->phase + run * interp->decimation)
+			% interp->phases;
+	}
+
+	apply_trim(interp);
+}
+
+void interpolator_exit(struct interpolator_t *interp) {
+	free(interp->coeffs);
+	free(interp->history);
+}
@@ -0,0 +1,74 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* context for a polyphase interpolator */
+typedef struct interpolator_t {
+	/*
+	 * Rate change as a fraction in lowest terms: upsample by the
+	 * number of phases, then keep every decimation-th sample
+	 */
+	uint16_t phases;
+	uint16_t decimation;
+
+	/* filter length of each phase */
+	uint8_t taps;
+
+	/*
+	 * Filter coefficients
+	 *
+	 * One row for each tap, holding the phases in the order the
+	 * output samples use them, so all the output samples that come
+	 * from the same input history can be computed together
+	 */
+	float *coeffs;
+
+	/*
+	 * Input history (newest first)
+	 *
+	 * This is stored twice in a row so it can be read linearly
+	 */
+	float *history;
+	uint8_t history_pos;
+
+	/* phase of the next output sample */
+	uint16_t phase;
+
+	/* where the next output sample is in the rows of coefficients */
+	uint16_t row_pos;
+
+	/* how far the rows move on when the phase moves on by one */
+	uint16_t unit_row;
+
+	/*
+	 * Output clock trim: phases to add for every output sample, and
+	 * what has built up of them that hasn't been applied yet
+	 */
+	float trim_step;
+	float trim_acc;
+} interpolator_t;
+
+extern void interpolator_init(struct interpolator_t *interp,
+	uint32_t in_rate, uint32_t out_rate, uint8_t taps);
+extern void interpolator_sync(struct interpolator_t *interp,
+	const struct interpolator_t *ref);
+extern void interpolator_set_ppm(struct interpolator_t *interp, float ppm);
+extern size_t interpolator_input_needed(struct interpolator_t *interp,
+	size_t num_frames);
+extern void interpolate(struct interpolator_t *interp,
+	const float *in, float *out, size_t num_frames);
+extern void interpolator_exit(struct interpolator_t *interp);
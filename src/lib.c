@@ -205,16 +205,21 @@ uint16_t crc16(uint8_t *data, size_t len) {
 	return crc ^ 0xffff;
 }
 
-/* Calculate the checkword for each block and emit the bits */
+/*
+ * Calculate the checkword for each block and emit the bits
+ *
+ * The blocks are packed two at a time into GROUP_WORDS words
+ */
 #ifdef RDS2
-void add_checkwords(uint16_t *blocks, uint8_t *bits, bool rds2)
+void add_checkwords(uint16_t *blocks, uint64_t *bits, bool rds2)
 #else
-void add_checkwords(uint16_t *blocks, uint8_t *bits)
+void add_checkwords(uint16_t *blocks, uint64_t *bits)
 #endif
 {
 	size_t i, j;
 	uint8_t bit, msb;
 	uint16_t block, block_crc, check, offset_word;
+	uint64_t word = 0;
 	bool group_type_b = false;
 #ifdef RDS2
 	bool tunneling_type_b = false;
@@ -260,11 +265,16 @@ void add_checkwords(uint16_t *blocks, uint8_t *bits)
 			msb = (block_crc >> (POLY_DEG - 1)) & 1;
 			block_crc <<= 1;
 			if (msb ^ bit) block_crc ^= POLY;
-			*bits++ = bit;
 		}
-		check = block_crc ^ offset_word;
-		for (j = 0; j < POLY_DEG; j++) {
-			*bits++ = (check & ((1 << (POLY_DEG - 1)) >> j)) != 0;
+		check = (block_crc ^ offset_word) & ((1 << POLY_DEG) - 1);
+
+		/* append the block and its checkword to the current word */
+		word = (word << (BLOCK_SIZE + POLY_DEG))
+			| ((uint64_t)block << POLY_DEG) | check;
+
+		if (i % BLOCKS_PER_GROUP_WORD == BLOCKS_PER_GROUP_WORD - 1) {
+			*bits++ = word;
+			word = 0;
 		}
 	}
 }
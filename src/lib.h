@@ -25,9 +25,9 @@ extern char *get_pty_str(uint8_t pty_code);
 extern uint8_t get_rtp_tag_id(char *rtp_tag_name);
 extern char *get_rtp_tag_name(uint8_t rtp_tag);
 #ifdef RDS2
-extern void add_checkwords(uint16_t *blocks, uint8_t *bits, bool rds2);
+extern void add_checkwords(uint16_t *blocks, uint64_t *bits, bool rds2);
 #else
-extern void add_checkwords(uint16_t *blocks, uint8_t *bits);
+extern void add_checkwords(uint16_t *blocks, uint64_t *bits);
 #endif
 extern uint16_t callsign2pi(unsigned char *callsign);
 extern uint8_t add_rds_af(struct rds_af_t *af_list, float freq);
@@ -0,0 +1,193 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "limiter.h"
+#include "simd.h"
+
+/*
+ * Look-ahead peak limiter
+ *
+ * Every sample asks for the gain that would bring it down to the
+ * ceiling. The lowest of these is held for the look-ahead time, given
+ * a release and then averaged over the same time. Since the signal is
+ * delayed to line up with the end of the average, the gain has fully
+ * come down by the time a peak comes out, without the distortion a
+ * clipper would add.
+ *
+ */
+
+void limiter_init(struct limiter_t *lim, uint32_t sample_rate,
+	size_t max_frames) {
+	memset(lim, 0, sizeof(struct limiter_t));
+
+	lim->sample_rate = sample_rate;
+	lim->max_frames = max_frames;
+	lim->lookahead = (uint16_t)lroundf(
+		sample_rate * LIMITER_LOOKAHEAD_MS / 1000.0f);
+	if (lim->lookahead == 0) lim->lookahead = 1;
+
+	lim->delay = malloc((lim->lookahead - 1 + max_frames) * sizeof(float));
+	memset(lim->delay, 0, (lim->lookahead - 1) * sizeof(float));
+	lim->hold_gain = malloc(lim->lookahead * sizeof(float));
+	lim->hold_pos = malloc(lim->lookahead * sizeof(uint64_t));
+	lim->ring = malloc(lim->lookahead * sizeof(float));
+	for (uint16_t i = 0; i < lim->lookahead; i++) {
+		lim->ring[i] = 1.0f;
+	}
+	lim->ring_sum = lim->lookahead;
+	lim->gain = 1.0f;
+	lim->gains = malloc(max_frames * sizeof(float));
+
+	lim->meters.min_gain = 1.0f;
+
+	limiter_set(lim, LIMITER_CEILING, LIMITER_RELEASE_MS);
+}
+
+void limiter_set(struct limiter_t *lim, float ceiling, float release_ms) {
+	if (ceiling < 0.1f) ceiling = 0.1f;
+	if (ceiling > 1.0f) ceiling = 1.0f;
+	if (release_ms < 1.0f) release_ms = 1.0f;
+	if (release_ms > LIMITER_MAX_RELEASE_MS)
+		release_ms = LIMITER_MAX_RELEASE_MS;
+
+	lim->ceiling = ceiling;
+	lim->release = 1.0f - expf(-1000.0f / (release_ms * lim->sample_rate));
+}
+
+/*
+ * Work out the gain of each sample in the block
+ */
+static void get_gains(struct limiter_t *lim, const float *in,
+	size_t num_frames) {
+	uint16_t lookahead = lim->lookahead;
+	uint16_t last;
+	float level, wanted, hold, gain;
+	float old;
+
+	for (size_t i = 0; i < num_frames; i++) {
+		lim->pos++;
+
+		/* drop the reduction that just left the window */
+		if (lim->hold_count &&
+			lim->hold_pos[lim->hold_first] + lookahead <= lim->pos) {
+			lim->hold_first = (lim->hold_first + 1) % lookahead;
+			lim->hold_count--;
+		}
+
+		level = fabsf(in[i]);
+		if (level > lim->ceiling) {
+			wanted = lim->ceiling / level;
+
+			/* anything larger can never be the lowest again */
+			while (lim->hold_count) {
+				last = (lim->hold_first + lim->hold_count - 1)
+					% lookahead;
+				if (lim->hold_gain[last] < wanted) break;
+				lim->hold_count--;
+			}
+
+			last = (lim->hold_first + lim->hold_count) % lookahead;
+			lim->hold_gain[last] = wanted;
+			lim->hold_pos[last] = lim->pos;
+			lim->hold_count++;
+
+			lim->meters.limited++;
+		}
+
+		hold = lim->hold_count ? lim->hold_gain[lim->hold_first] : 1.0f;
+
+		/* release */
+		gain = lim->gain + (1.0f - lim->gain) * lim->release;
+		/*
+		 * Close to unity the step rounds away and the gain would
+		 * stay just under it, so finish the release there
+		 */
+		if (gain == lim->gain) gain = 1.0f;
+		if (gain > hold) gain = hold;
+		lim->gain = gain;
+
+		/* moving average */
+		old = lim->ring[lim->ring_pos];
+		if (old < 1.0f) lim->ring_reduced--;
+		if (gain < 1.0f) lim->ring_reduced++;
+		lim->ring[lim->ring_pos] = gain;
+		lim->ring_sum += gain - old;
+		if (++lim->ring_pos == lookahead) lim->ring_pos = 0;
+
+		/* don't let rounding errors build up */
+		if (lim->ring_reduced == 0) lim->ring_sum = lookahead;
+
+		lim->gains[i] = (float)(lim->ring_sum / lookahead);
+		if (lim->gains[i] < lim->meters.min_gain)
+			lim->meters.min_gain = lim->gains[i];
+	}
+}
+
+void limiter_process(struct limiter_t *lim, float *buf, size_t num_frames) {
+	float *delayed = lim->delay;
+	uint16_t history = lim->lookahead - 1;
+	float peak = 0.0f;
+	float sum_sq = 0.0f;
+
+	for (size_t i = 0; i < num_frames; i++) {
+		if (fabsf(buf[i]) > peak) peak = fabsf(buf[i]);
+		sum_sq += buf[i] * buf[i];
+	}
+
+	if (peak > lim->meters.peak) lim->meters.peak = peak;
+	lim->sum_sq += sum_sq;
+	lim->meters.frames += num_frames;
+
+	memcpy(delayed + history, buf, num_frames * sizeof(float));
+
+	if (peak <= lim->ceiling && lim->hold_count == 0 &&
+		lim->gain == 1.0f && lim->ring_reduced == 0) {
+		/* nothing to do but delay the signal */
+		lim->pos += num_frames;
+		memcpy(buf, delayed, num_frames * sizeof(float));
+	} else {
+		get_gains(lim, buf, num_frames);
+		memset(buf, 0, num_frames * sizeof(float));
+		simd_modulate(buf, delayed, lim->gains, 1.0f, num_frames);
+	}
+
+	memmove(delayed, delayed + num_frames, history * sizeof(float));
+}
+
+/*
+ * Read the meters and start measuring again
+ */
+void limiter_get_meters(struct limiter_t *lim,
+	struct limiter_meters_t *meters) {
+	*meters = lim->meters;
+	if (lim->meters.frames)
+		meters->rms = sqrt(lim->sum_sq / lim->meters.frames);
+
+	memset(&lim->meters, 0, sizeof(struct limiter_meters_t));
+	lim->meters.min_gain = 1.0f;
+	lim->sum_sq = 0.0;
+}
+
+void limiter_exit(struct limiter_t *lim) {
+	free(lim->delay);
+	free(lim->hold_gain);
+	free(lim->hold_pos);
+	free(lim->ring);
+	free(lim->gains);
+}
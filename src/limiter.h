@@ -0,0 +1,104 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* look-ahead time of the composite limiter */
+#define LIMITER_LOOKAHEAD_MS	0.5f
+
+/* defaults */
+#define LIMITER_CEILING		1.0f
+#define LIMITER_RELEASE_MS	20.0f
+
+/*
+ * Longest release (ms)
+ *
+ * The release step rounds away in float somewhat below unity, where
+ * the gain is snapped to 1. The slower the release the further below,
+ * which is about 0.05 dB at this length.
+ */
+#define LIMITER_MAX_RELEASE_MS	1000.0f
+
+/* level meters (collected since they were last read) */
+typedef struct limiter_meters_t {
+	/* input peak and RMS */
+	float peak;
+	float rms;
+
+	/* lowest gain applied */
+	float min_gain;
+
+	/* samples that went over the ceiling */
+	uint32_t limited;
+
+	/* samples measured */
+	uint32_t frames;
+} limiter_meters_t;
+
+/* context for a look-ahead peak limiter */
+typedef struct limiter_t {
+	float ceiling;
+
+	/* per sample recovery of the gain towards unity */
+	float release;
+	uint32_t sample_rate;
+
+	/* look-ahead length in samples */
+	uint16_t lookahead;
+
+	/*
+	 * Input delayed by lookahead - 1 samples, followed by the block
+	 * being processed
+	 */
+	float *delay;
+	size_t max_frames;
+
+	/*
+	 * Gain reductions still inside the look-ahead window
+	 *
+	 * Kept in a ring as an ascending queue so the lowest one is always
+	 * the first entry
+	 */
+	float *hold_gain;
+	uint64_t *hold_pos;
+	uint16_t hold_first;
+	uint16_t hold_count;
+	uint64_t pos;
+
+	/* released gain, averaged over the look-ahead window */
+	float gain;
+	float *ring;
+	uint16_t ring_pos;
+	uint16_t ring_reduced;
+	double ring_sum;
+
+	/* gain for each sample of the current block */
+	float *gains;
+
+	/* meters */
+	double sum_sq;
+	struct limiter_meters_t meters;
+} limiter_t;
+
+extern void limiter_init(struct limiter_t *lim, uint32_t sample_rate,
+	size_t max_frames);
+extern void limiter_set(struct limiter_t *lim, float ceiling,
+	float release_ms);
+extern void limiter_process(struct limiter_t *lim, float *buf,
+	size_t num_frames);
+extern void limiter_get_meters(struct limiter_t *lim,
+	struct limiter_meters_t *meters);
+extern void limiter_exit(struct limiter_t *lim);
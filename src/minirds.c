@@ -20,15 +20,23 @@
 #include <signal.h>
 #include <getopt.h>
 #include <pthread.h>
-#include <ao/ao.h>
 
 #include "rds.h"
 #include "fm_mpx.h"
+#include "modulator.h"
 #include "control_pipe.h"
 #include "resampler.h"
+#include "drift.h"
+#include "output.h"
 #include "net.h"
 #include "lib.h"
 #include "ascii_cmd.h"
+#ifdef STEREO_ENCODER
+#include "audio.h"
+#endif
+#ifdef MPX_INPUT
+#include "mpx_input.h"
+#endif
 
 static uint8_t stop_rds;
 
@@ -36,30 +44,6 @@ static void stop() {
 	stop_rds = 1;
 }
 
-static inline void float2char2channel(
-	float *inbuf, char *outbuf, size_t frames) {
-	uint16_t j = 0, k = 0;
-	int16_t sample;
-	int8_t lower, upper;
-
-	for (uint16_t i = 0; i < frames; i++) {
-		sample = lroundf((inbuf[j] + inbuf[j+1]) * 16383.5f);
-
-		/* convert from short to char */
-		lower = sample & 255;
-		sample >>= 8;
-		upper = sample & 255;
-
-		outbuf[k+0] = lower;
-		outbuf[k+1] = upper;
-		outbuf[k+2] = lower;
-		outbuf[k+3] = upper;
-
-		j += 2;
-		k += 4;
-	}
-}
-
 /* threads */
 static void *control_pipe_worker() {
 	while (!stop_rds) {
@@ -89,7 +73,40 @@ static void show_help(char *name, struct rds_params_t def_params) {
 		"Usage: %s [options]\n"
 		"\n"
 		"    -m,--volume       Output volume\n"
+		"    -o,--output       Where the MPX signal goes: ao[:<driver>],\n"
+#ifdef ALSA_OUTPUT
+		"                        alsa[:<device>],\n"
+#endif
+		"                        raw[:<file>] (stdout by default),\n"
+		"                        wav:<file> or null [default: %s]\n"
+		"    -F,--format       Output sample format: s16, s24, s32\n"
+		"                        or float [default: the output's own]\n"
+		"    -k,--period       Frames per write (the ALSA period)\n"
+		"                        [default: the output's own]\n"
+#ifdef ALSA_OUTPUT
+		"    -K,--buffer       ALSA buffer size in frames\n"
+		"                        [default: %u periods]\n"
+#endif
+		"\n"
+#ifdef STEREO_ENCODER
+		"    -a,--audio        Stereo audio input (WAV or raw file,\n"
+		"                        \"-\" for stdin, alsa:<device>)\n"
+		"    -b,--audio-rate   Sample rate of raw or ALSA input\n"
+		"                        [default: %u]\n"
+		"    -e,--preemphasis  Pre-emphasis time constant in us\n"
+		"                        (0 to disable) [default: %.0f]\n"
+		"    -L,--audio-level  Audio level in percent\n"
+		"                        [default: 80]\n"
+		"\n"
+#endif
+#ifdef MPX_INPUT
+		"    -x,--mpx-input    External MPX signal to insert RDS into\n"
+		"                        (WAV or raw file, \"-\" for stdin,\n"
+		"                        alsa:<device>)\n"
+		"    -X,--mpx-rate     Sample rate of raw or ALSA MPX input\n"
+		"                        [default: %u]\n"
 		"\n"
+#endif
 #ifdef RBDS
 		"    -i,--pi           Program Identification code or callsign\n"
 		"                      (PI code will be calculated from callsign)\n"
@@ -113,6 +130,15 @@ static void show_help(char *name, struct rds_params_t def_params) {
 		"                        (more than one AF may be passed)\n"
 		"    -P,--ptyn         Program Type Name\n"
 		"\n"
+#ifdef RDS2
+		"    -N,--rds2-streams Number of RDS2 streams (0-3)\n"
+		"                        [default: %u]\n"
+		"    -Q,--quadrature   RDS2 carriers in quadrature (0 or 1)\n"
+		"                        [default: %u]\n"
+		"    -y,--shift        RDS2 symbol shift of streams 1-3\n"
+		"                        (fractions of a bit, e.g. 0.5,0.25,0.75)\n"
+		"\n"
+#endif
 		"    -C,--ctl          FIFO control pipe\n"
 		"\n"
 		"    -h,--help         Show this help text and exit\n"
@@ -120,9 +146,22 @@ static void show_help(char *name, struct rds_params_t def_params) {
 		"\n",
 		VERSION,
 		name,
+		DEFAULT_OUTPUT,
+#ifdef ALSA_OUTPUT
+		ALSA_PERIODS,
+#endif
+#ifdef STEREO_ENCODER
+		DEFAULT_AUDIO_RATE, DEFAULT_PREEMPHASIS,
+#endif
+#ifdef MPX_INPUT
+		DEFAULT_MPX_INPUT_RATE,
+#endif
 		def_params.pi, def_params.ps,
 		def_params.rt, def_params.pty,
 		def_params.tp
+#ifdef RDS2
+		, DEFAULT_RDS2_STREAMS, DEFAULT_RDS2_QUADRATURE
+#endif
 	);
 }
 
@@ -148,25 +187,57 @@ int main(int argc, char **argv) {
 		.pi = 0x1000
 	};
 	float volume = 50.0f;
+#ifdef RDS2
+	uint8_t rds2_streams = DEFAULT_RDS2_STREAMS;
+	bool quadrature = DEFAULT_RDS2_QUADRATURE;
+	float shifts[3];
+	bool set_shifts = false;
+#endif
+#ifdef STEREO_ENCODER
+	char *audio_input = NULL;
+	uint32_t audio_rate = DEFAULT_AUDIO_RATE;
+	float preemphasis = DEFAULT_PREEMPHASIS;
+	float audio_volume = 80.0f;
+#endif
+#ifdef MPX_INPUT
+	char *mpx_input = NULL;
+	uint32_t mpx_input_rate = DEFAULT_MPX_INPUT_RATE;
+#endif
 
-	/* buffers */
-	float *mpx_buffer;
+	/* buffers (mono) */
+	sample_t *mpx_buffer;
+#if MPX_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
 	float *out_buffer;
-	char *dev_out;
+#endif
 
 	uint16_t port = 0;
 	uint8_t proto = 1;
 
 	int8_t r;
 	size_t frames;
+	/* exit status */
+	int status = 0;
+
+#if MPX_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
+	/* MPX -> output */
+	struct resampler_t resampler;
+	float resampler_ppm = 0.0f;
+	size_t mpx_buffer_frames;
+	/* MPX frames the resampler hasn't taken yet */
+	size_t mpx_frames = 0;
+	size_t needed, used;
+#endif
 
-	/* SRC */
-	SRC_STATE *src_state;
-	SRC_DATA src_data;
+	/* sound card clock tracking */
+	struct drift_t drift;
+	bool tracking = false;
 
-	/* AO */
-	ao_device *device;
-	ao_sample_format format;
+	/* output */
+	char *output_name = DEFAULT_OUTPUT;
+	int8_t output_format = -1;
+	size_t output_period = 0;
+	size_t output_buffer = 0;
+	struct output_t output;
 
 	/* pthread */
 	pthread_attr_t attr;
@@ -179,15 +250,44 @@ int main(int argc, char **argv) {
 	pthread_mutex_t net_ctl_mutex = PTHREAD_MUTEX_INITIALIZER;
 	pthread_cond_t net_ctl_cond;
 
-	const char	*short_opt = "m:R:i:s:r:p:T:A:P:"
+	const char	*short_opt = "m:o:F:k:"
+#ifdef ALSA_OUTPUT
+	"K:"
+#endif
+#ifdef STEREO_ENCODER
+	"a:b:e:L:"
+#endif
+#ifdef MPX_INPUT
+	"x:X:"
+#endif
+	"R:i:s:r:p:T:A:P:"
 #ifdef RBDS
 	"S:"
+#endif
+#ifdef RDS2
+	"N:Q:y:"
 #endif
 	"C:hv";
 
 	struct option	long_opt[] =
 	{
 		{"volume",	required_argument, NULL, 'm'},
+		{"output",	required_argument, NULL, 'o'},
+		{"format",	required_argument, NULL, 'F'},
+		{"period",	required_argument, NULL, 'k'},
+#ifdef ALSA_OUTPUT
+		{"buffer",	required_argument, NULL, 'K'},
+#endif
+#ifdef STEREO_ENCODER
+		{"audio",	required_argument, NULL, 'a'},
+		{"audio-rate",	required_argument, NULL, 'b'},
+		{"preemphasis",	required_argument, NULL, 'e'},
+		{"audio-level",	required_argument, NULL, 'L'},
+#endif
+#ifdef MPX_INPUT
+		{"mpx-input",	required_argument, NULL, 'x'},
+		{"mpx-rate",	required_argument, NULL, 'X'},
+#endif
 
 		{"rds",		required_argument, NULL, 'R'},
 		{"pi",		required_argument, NULL, 'i'},
@@ -197,6 +297,11 @@ int main(int argc, char **argv) {
 		{"tp",		required_argument, NULL, 'T'},
 		{"af",		required_argument, NULL, 'A'},
 		{"ptyn",	required_argument, NULL, 'P'},
+#ifdef RDS2
+		{"rds2-streams",	required_argument, NULL, 'N'},
+		{"quadrature",	required_argument, NULL, 'Q'},
+		{"shift",	required_argument, NULL, 'y'},
+#endif
 		{"ctl",		required_argument, NULL, 'C'},
 
 		{"help",	no_argument, NULL, 'h'},
@@ -217,6 +322,57 @@ keep_parsing_opts:
 			if (check_mpx_vol(volume) > 0) return 1;
 			break;
 
+		case 'o': /* output */
+			output_name = optarg;
+			break;
+
+		case 'F': /* format */
+			output_format = get_output_format(optarg);
+			if (output_format < 0) {
+				fprintf(stderr, "Unknown sample format %s.\n",
+					optarg);
+				return 1;
+			}
+			break;
+
+		case 'k': /* period */
+			output_period = strtoul(optarg, NULL, 10);
+			break;
+
+#ifdef ALSA_OUTPUT
+		case 'K': /* buffer */
+			output_buffer = strtoul(optarg, NULL, 10);
+			break;
+#endif
+
+#ifdef STEREO_ENCODER
+		case 'a': /* audio */
+			audio_input = optarg;
+			break;
+
+		case 'b': /* audio-rate */
+			audio_rate = strtoul(optarg, NULL, 10);
+			break;
+
+		case 'e': /* preemphasis */
+			preemphasis = strtof(optarg, NULL);
+			break;
+
+		case 'L': /* audio-level */
+			audio_volume = strtof(optarg, NULL);
+			break;
+#endif
+
+#ifdef MPX_INPUT
+		case 'x': /* mpx-input */
+			mpx_input = optarg;
+			break;
+
+		case 'X': /* mpx-rate */
+			mpx_input_rate = strtoul(optarg, NULL, 10);
+			break;
+#endif
+
 		case 'i': /* pi */
 #ifdef RBDS
 			if (optarg[0] == 'K' || optarg[0] == 'W' ||
@@ -255,6 +411,29 @@ keep_parsing_opts:
 			memcpy(rds_params.ptyn, xlat((unsigned char *)optarg), PTYN_LENGTH);
 			break;
 
+#ifdef RDS2
+		case 'N': /* rds2-streams */
+			rds2_streams = strtoul(optarg, NULL, 10);
+			if (rds2_streams > 3) {
+				fprintf(stderr, "There can be 0-3 RDS2 streams.\n");
+				return 1;
+			}
+			break;
+
+		case 'Q': /* quadrature */
+			quadrature = strtoul(optarg, NULL, 10) != 0;
+			break;
+
+		case 'y': /* shift */
+			if (sscanf(optarg, "%f,%f,%f",
+				&shifts[0], &shifts[1], &shifts[2]) != 3) {
+				fprintf(stderr, "Invalid symbol shift list.\n");
+				return 1;
+			}
+			set_shifts = true;
+			break;
+#endif
+
 		case 'C': /* ctl */
 			memcpy(control_pipe, optarg, 50);
 			break;
@@ -274,6 +453,18 @@ keep_parsing_opts:
 
 done_parsing_opts:
 
+#if defined(STEREO_ENCODER) && defined(MPX_INPUT)
+	if (audio_input && mpx_input) {
+		fprintf(stderr, "Audio input and MPX input "
+			"can't be used together.\n");
+		return 1;
+	}
+#endif
+
+	/* Open where the MPX signal goes */
+	if (open_output(&output, output_name, OUTPUT_SAMPLE_RATE,
+		output_format, output_period, output_buffer) < 0) return 1;
+
 	/* Initialize pthread stuff */
 	pthread_mutex_init(&control_pipe_mutex, NULL);
 	pthread_cond_init(&control_pipe_cond, NULL);
@@ -282,9 +473,15 @@ done_parsing_opts:
 	pthread_attr_init(&attr);
 
 	/* Setup buffers */
-	mpx_buffer = malloc(NUM_MPX_FRAMES_IN * 2 * sizeof(float));
-	out_buffer = malloc(NUM_MPX_FRAMES_OUT * 2 * sizeof(float));
-	dev_out = malloc(NUM_MPX_FRAMES_OUT * 2 * sizeof(int16_t) * sizeof(char));
+#if MPX_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
+	/* room for the MPX frames of one write */
+	mpx_buffer_frames = (size_t)ceil(output.block_frames
+		* (double)MPX_SAMPLE_RATE / OUTPUT_SAMPLE_RATE) + 16;
+	mpx_buffer = malloc(mpx_buffer_frames * sizeof(sample_t));
+	out_buffer = malloc(output.block_frames * sizeof(float));
+#else
+	mpx_buffer = malloc(output.block_frames * sizeof(sample_t));
+#endif
 
 	/* Gracefully stop the encoder on SIGINT or SIGTERM */
 	signal(SIGINT, stop);
@@ -293,40 +490,52 @@ done_parsing_opts:
 	/* Initialize the baseband generator */
 	fm_mpx_init(MPX_SAMPLE_RATE);
 	set_output_volume(volume);
+#ifdef RDS2
+	set_rds2_streams(rds2_streams);
+	set_rds2_quadrature(quadrature);
+#endif
 
-	/* Initialize the RDS modulator */
-	init_rds_encoder(rds_params);
-
-	/* AO format */
-	memset(&format, 0, sizeof(struct ao_sample_format));
-	format.channels = 2;
-	format.bits = 16;
-	format.rate = OUTPUT_SAMPLE_RATE;
-	format.byte_format = AO_FMT_LITTLE;
-
-	ao_initialize();
+#ifdef STEREO_ENCODER
+	/* Open the audio input for the stereo encoder */
+	set_audio_volume(audio_volume);
+	if (audio_input) {
+		if (open_audio_input(audio_input, audio_rate,
+			preemphasis) < 0) {
+			status = 1;
+			goto close_inputs;
+		}
+	}
+#endif
 
-	device = ao_open_live(ao_default_driver_id(), &format, NULL);
-	if (device == NULL) {
-		fprintf(stderr, "Error: cannot open sound device.\n");
-		ao_shutdown();
-		goto exit;
+#ifdef MPX_INPUT
+	/* Open the external MPX signal to insert RDS into */
+	if (mpx_input) {
+		if (open_mpx_input(mpx_input, mpx_input_rate) < 0) {
+			status = 1;
+			goto close_inputs;
+		}
 	}
+#endif
 
-	/* SRC out (MPX -> output) */
-	memset(&src_data, 0, sizeof(SRC_DATA));
-	src_data.input_frames = NUM_MPX_FRAMES_IN;
-	src_data.output_frames = NUM_MPX_FRAMES_OUT;
-	src_data.src_ratio =
-		(double)OUTPUT_SAMPLE_RATE / (double)MPX_SAMPLE_RATE;
-	src_data.data_in = mpx_buffer;
-	src_data.data_out = out_buffer;
+	/* Initialize the RDS modulator */
+	init_rds_encoder(rds_params);
+#ifdef RDS2
+	if (set_shifts) {
+		set_rds_symbol_shift(1, shifts[0]);
+		set_rds_symbol_shift(2, shifts[1]);
+		set_rds_symbol_shift(3, shifts[2]);
+	}
+#endif
 
-	r = resampler_init(&src_state, 2);
+#if MPX_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
+	/* MPX -> output */
+	r = resampler_init(&resampler, MPX_SAMPLE_RATE, OUTPUT_SAMPLE_RATE, 1);
 	if (r < 0) {
 		fprintf(stderr, "Could not create output resampler.\n");
-		goto exit;
+		status = 1;
+		goto exit_rds;
 	}
+#endif
 
 	/* Initialize the control pipe reader */
 	if (control_pipe[0]) {
@@ -334,9 +543,10 @@ done_parsing_opts:
 			fprintf(stderr, "Reading control commands on %s.\n", control_pipe);
 			/* Create control pipe polling worker */
 			r = pthread_create(&control_pipe_thread, &attr, control_pipe_worker, NULL);
-			if (r < 0) {
+			if (r != 0) {
 				fprintf(stderr, "Could not create control pipe thread.\n");
 				control_pipe[0] = 0;
+				status = 1;
 				goto exit;
 			} else {
 				fprintf(stderr, "Created control pipe thread.\n");
@@ -352,8 +562,10 @@ done_parsing_opts:
 		if (open_ctl_socket(port, proto) == 0) {
 			fprintf(stderr, "Reading control commands on port %d.\n", port);
 			r = pthread_create(&net_ctl_thread, &attr, net_ctl_worker, NULL);
-			if (r < 0) {
+			if (r != 0) {
 				fprintf(stderr, "Could not create network control thread.\n");
+				port = 0;
+				status = 1;
 				goto exit;
 			} else {
 				fprintf(stderr, "Created network control thread.\n");
@@ -364,17 +576,62 @@ done_parsing_opts:
 	}
 
 	for (;;) {
-		fm_rds_get_frames(mpx_buffer, NUM_MPX_FRAMES_IN);
+#if MPX_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
+		if (get_output_ppm() != resampler_ppm) {
+			resampler_ppm = get_output_ppm();
+			resampler_set_ppm(&resampler, resampler_ppm);
+		}
 
-		if (resample(src_state, src_data, &frames) < 0) break;
+		/* generate only the MPX frames this write needs */
+		needed = resampler_input_needed(&resampler,
+			output.block_frames);
+		if (needed > mpx_buffer_frames) needed = mpx_buffer_frames;
+		if (needed > mpx_frames) {
+			fm_rds_get_frames(mpx_buffer + mpx_frames,
+				needed - mpx_frames);
+			mpx_frames = needed;
+		}
+
+		if (resample(&resampler, mpx_buffer, mpx_frames, &used,
+			out_buffer, output.block_frames, &frames) < 0) {
+			status = 1;
+			break;
+		}
 
-		float2char2channel(out_buffer, dev_out, frames);
+		/* keep what wasn't taken for the next write */
+		mpx_frames -= used;
+		memmove(mpx_buffer, mpx_buffer + used,
+			mpx_frames * sizeof(sample_t));
 
-		/* num_bytes = audio frames * channels * bytes per sample */
-		if (!ao_play(device, dev_out, frames * 2 * sizeof(int16_t))) {
-			fprintf(stderr, "Error: could not play audio.\n");
+		if (write_output(&output, out_buffer, frames) < 0) {
+			status = 1;
 			break;
 		}
+#else
+		/* already at the output rate */
+		frames = output.block_frames;
+		fm_rds_get_frames(mpx_buffer, frames);
+
+		if (write_output(&output, mpx_buffer, frames) < 0) {
+			status = 1;
+			break;
+		}
+#endif
+
+		set_output_latency(get_output_latency(&output));
+
+		/* follow the sound card clock (files have none) */
+		if (get_auto_ppm() && output.backend->realtime) {
+			if (!tracking) {
+				drift_init(&drift, OUTPUT_SAMPLE_RATE,
+					DRIFT_BANDWIDTH, MAX_OUTPUT_PPM,
+					get_output_ppm());
+				tracking = true;
+			}
+			set_output_ppm(drift_update(&drift, frames));
+		} else {
+			tracking = false;
+		}
 
 		if (stop_rds) {
 			fprintf(stderr, "Stopping...\n");
@@ -382,9 +639,8 @@ done_parsing_opts:
 		}
 	}
 
-	resampler_exit(src_state);
-
 exit:
+	/* only what has been set up by the time of a failure is undone */
 	if (control_pipe[0]) {
 		/* shut down threads */
 		fprintf(stderr, "Waiting for pipe thread to shut down.\n");
@@ -398,14 +654,31 @@ exit:
 		pthread_join(net_ctl_thread, NULL);
 	}
 
+#if MPX_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
+	resampler_exit(&resampler);
+
+exit_rds:
+#endif
+	exit_rds_encoder();
+
+#if defined(STEREO_ENCODER) || defined(MPX_INPUT)
+close_inputs:
+#endif
 	pthread_attr_destroy(&attr);
 
+#ifdef STEREO_ENCODER
+	close_audio_input();
+#endif
+#ifdef MPX_INPUT
+	close_mpx_input();
+#endif
 	fm_mpx_exit();
-	exit_rds_encoder();
+	close_output(&output);
 
 	free(mpx_buffer);
+#if MPX_SAMPLE_RATE != OUTPUT_SAMPLE_RATE
 	free(out_buffer);
-	free(dev_out);
+#endif
 
-	return 0;
+	return status;
 }
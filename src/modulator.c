@@ -24,160 +24,358 @@
 #include "fm_mpx.h"
 #include "waveforms.h"
 #include "modulator.h"
+#ifndef RDS_SYMBOL_TABLE
+#include "simd.h"
+#endif
 
-static struct rds_t **rds_ctx;
-static float **waveform;
+static struct rds_t *rds_ctx;
+/* elementary biphase symbol */
+static const float *pulse;
+#ifdef RDS_SYMBOL_TABLE
+static sample_t *symbol_table;
 
 /*
- * Create the RDS objects
+ * Precompute one bit period of the envelope for every possible window
+ * of differentially encoded symbols
  *
+ * Bit n of the window index is the symbol that was sent n bits ago.
+ * Its pulse contributes the n-th bit period worth of samples.
  */
-void init_rds_objects() {
-	rds_ctx = malloc(NUM_STREAMS * sizeof(struct rds_t));
+static void init_symbol_table() {
+	sample_t *segment;
+	float sample;
 
-	for (uint8_t i = 0; i < NUM_STREAMS; i++) {
-		rds_ctx[i] = malloc(sizeof(struct rds_t));
-		rds_ctx[i]->bit_buffer = malloc(BITS_PER_GROUP);
-		rds_ctx[i]->sample_buffer =
-			malloc(SAMPLE_BUFFER_SIZE * sizeof(float));
+	symbol_table = alloc_aligned(NUM_SYMBOL_WINDOWS * ENV_SAMPLES_PER_BIT
+		* sizeof(sample_t));
 
-#ifdef RDS2_SYMBOL_SHIFTING
-		/*
-		 * symbol shifting to reduce total power of aggregate carriers
-		 *
-		 * see:
-		 * https://ietresearch.onlinelibrary.wiley.com/doi/pdf/10.1049/el.2019.0292
-		 * for more information
-		 */
-		switch (i) {
-		case 1:
-			/* time offset of 1/2 */
-			rds_ctx[i]->symbol_shift = SAMPLES_PER_BIT / 2;
-			rds_ctx[i]->symbol_shift_buf = malloc(
-				rds_ctx[i]->symbol_shift * sizeof(float));
-			memset(rds_ctx[i]->symbol_shift_buf, 0,
-				rds_ctx[i]->symbol_shift * sizeof(float));
-			break;
-		case 2:
-			/* time offset of 1/4 */
-			rds_ctx[i]->symbol_shift = SAMPLES_PER_BIT / 4;
-			rds_ctx[i]->symbol_shift_buf = malloc(
-				rds_ctx[i]->symbol_shift * sizeof(float));
-			memset(rds_ctx[i]->symbol_shift_buf, 0,
-				rds_ctx[i]->symbol_shift * sizeof(float));
-			break;
-		case 3:
-			/* time offset of 3/4 */
-			rds_ctx[i]->symbol_shift = (SAMPLES_PER_BIT / 4) * 3;
-			rds_ctx[i]->symbol_shift_buf = malloc(
-				rds_ctx[i]->symbol_shift * sizeof(float));
-			memset(rds_ctx[i]->symbol_shift_buf, 0,
-				rds_ctx[i]->symbol_shift * sizeof(float));
-			break;
-		default: /* stream 0 */
-			/* no time offset */
-			rds_ctx[i]->symbol_shift = 0;
-			break;
+	for (uint16_t w = 0; w < NUM_SYMBOL_WINDOWS; w++) {
+		segment = symbol_table + w * ENV_SAMPLES_PER_BIT;
+
+		for (uint16_t j = 0; j < ENV_SAMPLES_PER_BIT; j++) {
+			sample = 0.0f;
+			for (uint8_t n = 0; n < SYMBOL_WINDOW_BITS; n++) {
+				sample += ((w >> n) & 1 ? +1.0f : -1.0f)
+					* pulse[n * ENV_SAMPLES_PER_BIT + j];
+			}
+			segment[j] = TO_SAMPLE(sample);
 		}
+	}
+}
 #endif
-		rds_ctx[i]->symbol_shift_buf_idx = 0;
 
-	}
+#ifdef RDS_PREMODULATED
+static sample_t *premod_table;
 
-	waveform = malloc(2 * sizeof(float));
+/*
+ * Put the 57 kHz carrier onto the symbol table for stream 0
+ *
+ * Every bit is exactly 48 carrier cycles long, so the carrier is at the
+ * same phase at the start of every bit and each bit period of the
+ * modulated signal only depends on the symbol window.
+ */
+static void init_premod_table() {
+	const double w = M_2PI * 57000.0;
 
-	for (uint8_t i = 0; i < 2; i++) {
-		waveform[i] = malloc(FILTER_SIZE * sizeof(float));
-		for (uint16_t j = 0; j < FILTER_SIZE; j++) {
-			waveform[i][j] = i ?
-				+waveform_biphase[j] : -waveform_biphase[j];
-		}
+	premod_table = alloc_aligned(NUM_SYMBOL_WINDOWS * SAMPLES_PER_BIT
+		* sizeof(sample_t));
+
+	for (uint16_t i = 0; i < NUM_SYMBOL_WINDOWS * SAMPLES_PER_BIT; i++) {
+		premod_table[i] = TO_SAMPLE(FROM_SAMPLE(symbol_table[i])
+			* (float)cos(w * ((double)(i % SAMPLES_PER_BIT)
+			/ RDS_SAMPLE_RATE)));
 	}
 }
+#endif
 
-void exit_rds_objects() {
+/*
+ * Create the RDS objects
+ *
+ */
+void init_rds_objects() {
+	rds_ctx = alloc_aligned(sizeof(struct rds_t));
+	memset(rds_ctx, 0, sizeof(struct rds_t));
+
+	/* fetch a group and start a new bit on the first sample */
+	rds_ctx->bit_pos = BITS_PER_GROUP;
+	rds_ctx->sample_count = ENV_SAMPLES_PER_BIT;
+	rds_ctx->num_streams = 1;
+
+#ifdef RDS2_SYMBOL_SHIFTING
+	/* default offsets (can be changed at run-time) */
+	set_rds_symbol_shift(1, 0.5f);
+	set_rds_symbol_shift(2, 0.25f);
+	set_rds_symbol_shift(3, 0.75f);
+#endif
+
+	pulse = create_biphase_pulse(ENV_SAMPLE_RATE, PULSE_SPAN,
+		PULSE_WINDOW_RECTANGULAR);
+
+#ifdef RDS_SYMBOL_TABLE
+	init_symbol_table();
+#ifdef RDS_PREMODULATED
+	init_premod_table();
+#endif
+
+	/* start out on the all-zero symbol window */
 	for (uint8_t i = 0; i < NUM_STREAMS; i++) {
-		free(rds_ctx[i]->sample_buffer);
-		free(rds_ctx[i]->bit_buffer);
-		free(rds_ctx[i]);
-		if (rds_ctx[i]->symbol_shift) {
-			free(rds_ctx[i]->symbol_shift_buf);
-		}
+		rds_ctx->cur_segment[i] = symbol_table;
 	}
+#else
+	init_simd();
+	fprintf(stderr, "Using %s overlap-add kernel.\n", get_simd_name());
+#endif
+}
 
+void exit_rds_objects() {
 	free(rds_ctx);
 
-	for (uint8_t i = 0; i < 2; i++) {
-		free(waveform[i]);
-	}
+	free((void *)pulse);
 
-	free(waveform);
+#ifdef RDS_SYMBOL_TABLE
+	free(symbol_table);
+#endif
+#ifdef RDS_PREMODULATED
+	free(premod_table);
+#endif
 }
 
-/* Get an RDS sample. This generates the envelope of the waveform using
- * pre-generated elementary waveform samples.
+/*
+ * Symbol shifting to reduce total power of aggregate carriers
+ *
+ * The shift is a fraction of a bit period (0-1) that the stream lags
+ * behind the others. It is applied as an offset on the read position
+ * so no samples need to be copied around.
+ *
+ * see:
+ * https://ietresearch.onlinelibrary.wiley.com/doi/pdf/10.1049/el.2019.0292
+ * for more information
  */
-float get_rds_sample(uint8_t stream_num) {
-	struct rds_t *rds;
-	uint16_t idx;
-	float *cur_waveform;
-	float sample;
+void set_rds_symbol_shift(uint8_t stream_num, float shift) {
+	/* stream 0 is the reference */
+	if (stream_num == 0 || stream_num >= NUM_STREAMS) return;
+	if (shift < 0.0f || shift >= 1.0f) shift = 0.0f;
 
-	/* select context */
-	rds = rds_ctx[stream_num];
+	rds_ctx->symbol_shift[stream_num] =
+		(uint16_t)lroundf(shift * ENV_SAMPLES_PER_BIT)
+		% ENV_SAMPLES_PER_BIT;
+}
 
-	if (rds->sample_count == SAMPLES_PER_BIT) {
-		if (rds->bit_pos == BITS_PER_GROUP) {
-#ifdef RDS2
-			if (stream_num > 0) {
-				get_rds2_bits(stream_num, rds->bit_buffer);
-			} else {
-				get_rds_bits(rds->bit_buffer);
-			}
+/*
+ * Set how many streams are generated (stream 0 is always on)
+ *
+ * Streams that are switched off are skipped entirely. One that gets
+ * switched on starts from a clean state and carries filler symbols
+ * until the next group begins.
+ */
+void set_rds_streams(uint8_t num_streams) {
+	struct rds_t *rds = rds_ctx;
+
+	if (num_streams < 1) num_streams = 1;
+	if (num_streams > NUM_STREAMS) num_streams = NUM_STREAMS;
+
+	for (uint8_t i = rds->num_streams; i < num_streams; i++) {
+		memset(rds->group_symbols[i], 0, sizeof(rds->group_symbols[i]));
+		rds->symbols[i] = 0;
+#ifdef RDS_SYMBOL_TABLE
+		rds->cur_segment[i] = symbol_table;
+		rds->prev_segment[i] = symbol_table;
 #else
-			get_rds_bits(rds->bit_buffer);
+		memset(rds->sample_buffer[i], 0, sizeof(rds->sample_buffer[i]));
+#endif
+	}
+
+	rds->num_streams = num_streams;
+}
+
+/*
+ * Differentially encode a group word
+ *
+ * Each symbol is the XOR of the previous symbol and the current bit,
+ * so it is the XOR of all bits up to and including it. With the first
+ * bit in the MSB, that is a prefix XOR running down the word.
+ */
+static inline uint64_t diff_encode(uint64_t bits, uint8_t prev_output) {
+	bits ^= bits >> 1;
+	bits ^= bits >> 2;
+	bits ^= bits >> 4;
+	bits ^= bits >> 8;
+	bits ^= bits >> 16;
+	bits ^= bits >> 32;
+
+	if (prev_output) bits ^= GROUP_WORD_MASK;
+
+	return bits;
+}
+
+/*
+ * Fetch the next bit of every stream's group and start new symbols
+ *
+ */
+static void get_next_symbols(struct rds_t *rds) {
+	uint8_t prev_output;
+	uint8_t word_pos;
+	uint64_t window;
+#ifndef RDS_SYMBOL_TABLE
+	uint16_t span;
+	float sign;
 #endif
-			rds->bit_pos = 0;
+
+	if (rds->bit_pos == BITS_PER_GROUP) {
+		get_rds_bits(rds->group_symbols[0]);
+#ifdef RDS2
+		for (uint8_t i = 1; i < rds->num_streams; i++) {
+			get_rds2_bits(i, rds->group_symbols[i]);
 		}
+#endif
 
 		/* do differential encoding */
-		rds->cur_bit = rds->bit_buffer[rds->bit_pos++];
-		rds->prev_output = rds->cur_output;
-		rds->cur_output = rds->prev_output ^ rds->cur_bit;
+		for (uint8_t i = 0; i < rds->num_streams; i++) {
+			prev_output = rds->symbols[i] & 1;
+			for (uint8_t j = 0; j < GROUP_WORDS; j++) {
+				rds->group_symbols[i][j] = diff_encode(
+					rds->group_symbols[i][j], prev_output);
+				prev_output = rds->group_symbols[i][j] & 1;
+			}
+		}
 
-		idx = rds->in_sample_index;
-		cur_waveform = waveform[rds->cur_output];
+		rds->bit_pos = 0;
+	}
+
+	word_pos = rds->bit_pos % BITS_PER_GROUP_WORD;
 
-		for (uint16_t i = 0; i < FILTER_SIZE; i++) {
-			rds->sample_buffer[idx++] += *cur_waveform++;
-			if (idx == SAMPLE_BUFFER_SIZE) idx = 0;
+	/* move on to the next word */
+	if (word_pos == 0) {
+		for (uint8_t i = 0; i < rds->num_streams; i++) {
+			rds->symbols[i] =
+				(rds->symbols[i] << BITS_PER_GROUP_WORD) |
+				rds->group_symbols[i]
+					[rds->bit_pos / BITS_PER_GROUP_WORD];
 		}
+	}
+
+#ifndef RDS_SYMBOL_TABLE
+	/*
+	 * The pulse is added into the circular buffer as two linear spans
+	 * so the vector kernels don't have to check for wraparound
+	 */
+	span = ENV_BUFFER_SIZE - rds->in_sample_index;
+	if (span > ENV_FILTER_SIZE) span = ENV_FILTER_SIZE;
+#endif
+
+	for (uint8_t i = 0; i < rds->num_streams; i++) {
+		/* the new symbol is in the LSB, older ones above it */
+		window = rds->symbols[i] >> (BITS_PER_GROUP_WORD - 1 - word_pos);
+
+#ifdef RDS_SYMBOL_TABLE
+		rds->prev_segment[i] = rds->cur_segment[i];
+#ifdef RDS_PREMODULATED
+		/* stream 0 already has its carrier on it */
+		rds->cur_segment[i] = (i == 0 ? premod_table : symbol_table)
+			+ (window & SYMBOL_WINDOW_MASK) * ENV_SAMPLES_PER_BIT;
+#else
+		rds->cur_segment[i] = symbol_table
+			+ (window & SYMBOL_WINDOW_MASK) * ENV_SAMPLES_PER_BIT;
+#endif
+#else
+		sign = window & 1 ? +1.0f : -1.0f;
+		simd_mac(rds->sample_buffer[i] + rds->in_sample_index,
+			pulse, sign, span);
+		simd_mac(rds->sample_buffer[i],
+			pulse + span, sign, ENV_FILTER_SIZE - span);
+#endif
+	}
+
+	rds->bit_pos++;
+
+#ifndef RDS_SYMBOL_TABLE
+	rds->in_sample_index += ENV_SAMPLES_PER_BIT;
+	if (rds->in_sample_index == ENV_BUFFER_SIZE)
+		rds->in_sample_index = 0;
+#endif
+
+	rds->sample_count = 0;
+}
 
-		rds->in_sample_index += SAMPLES_PER_BIT;
-		if (rds->in_sample_index == SAMPLE_BUFFER_SIZE)
-			rds->in_sample_index = 0;
+/*
+ * Copy part of the current bit period of one stream
+ *
+ * A shifted stream reads the end of the previous bit period first
+ */
+static void copy_samples(struct rds_t *rds, uint8_t stream_num,
+	sample_t *buf, uint16_t num_samples) {
+	uint16_t shift = rds->symbol_shift[stream_num];
+	uint16_t n;
 
-		rds->sample_count = 0;
+#ifdef RDS_SYMBOL_TABLE
+	uint16_t pos = rds->sample_count;
+
+	if (pos < shift) {
+		n = shift - pos;
+		if (n > num_samples) n = num_samples;
+
+		memcpy(buf, rds->prev_segment[stream_num]
+			+ ENV_SAMPLES_PER_BIT + pos - shift, n * sizeof(sample_t));
+		buf += n;
+		pos += n;
+		num_samples -= n;
 	}
-	rds->sample_count++;
 
-	if (rds->symbol_shift) {
-		rds->symbol_shift_buf[rds->symbol_shift_buf_idx++] =
-			rds->sample_buffer[rds->out_sample_index];
+	memcpy(buf, rds->cur_segment[stream_num] + pos - shift,
+		num_samples * sizeof(sample_t));
+#else
+	float *sample_buffer = rds->sample_buffer[stream_num];
+	uint16_t idx;
+
+	/*
+	 * Positions behind the bit clock have not been written to by the
+	 * following bits yet
+	 */
+	idx = rds->out_sample_index + ENV_BUFFER_SIZE - shift;
+	if (idx >= ENV_BUFFER_SIZE) idx -= ENV_BUFFER_SIZE;
 
-		if (rds->symbol_shift_buf_idx == rds->symbol_shift)
-			rds->symbol_shift_buf_idx = 0;
+	while (num_samples) {
+		n = ENV_BUFFER_SIZE - idx;
+		if (n > num_samples) n = num_samples;
 
-		sample = rds->symbol_shift_buf[rds->symbol_shift_buf_idx];
+		memcpy(buf, sample_buffer + idx, n * sizeof(float));
+		memset(sample_buffer + idx, 0, n * sizeof(float));
 
-		goto done;
+		buf += n;
+		num_samples -= n;
+		idx = 0;
 	}
+#endif
+}
+
+/* Get a block of RDS samples for all active streams. This generates the
+ * envelope of the waveform using pre-generated elementary waveform samples.
+ *
+ * Stream n is written to buf + n * num_samples.
+ */
+void get_rds_samples(sample_t *buf, size_t num_samples) {
+	struct rds_t *rds = rds_ctx;
+	size_t done = 0;
+	uint16_t n;
 
-	sample = rds->sample_buffer[rds->out_sample_index];
-done:
-	rds->sample_buffer[rds->out_sample_index++] = 0;
-	if (rds->out_sample_index == SAMPLE_BUFFER_SIZE)
-		rds->out_sample_index = 0;
+	while (done < num_samples) {
+		if (rds->sample_count == ENV_SAMPLES_PER_BIT)
+			get_next_symbols(rds);
 
-	return sample;
+		/* copy up to the end of the current bit */
+		n = ENV_SAMPLES_PER_BIT - rds->sample_count;
+		if (n > num_samples - done) n = num_samples - done;
+
+		for (uint8_t i = 0; i < rds->num_streams; i++) {
+			copy_samples(rds, i, buf + i * num_samples + done, n);
+		}
+
+#ifndef RDS_SYMBOL_TABLE
+		rds->out_sample_index += n;
+		if (rds->out_sample_index == ENV_BUFFER_SIZE)
+			rds->out_sample_index = 0;
+#endif
+
+		rds->sample_count += n;
+		done += n;
+	}
 }
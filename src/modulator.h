@@ -16,27 +16,98 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/* most streams there can be (only the first few may be active) */
 #ifdef RDS2
 #define NUM_STREAMS	4
 #else
 #define NUM_STREAMS	1
 #endif
 
-/* RDS signal context */
+#if defined(NATIVE_RATE) && !defined(RDS_LOW_RATE_ENVELOPE)
+#error "NATIVE_RATE needs RDS_LOW_RATE_ENVELOPE"
+#endif
+
+#ifdef RDS_LOW_RATE_ENVELOPE
+/*
+ * Generate the envelope at 8 samples per bit (9.5 kHz) and bring it up
+ * to the MPX rate with a polyphase interpolator
+ *
+ * At the native rate the MPX rate doesn't have to be a multiple of
+ * the envelope rate since the interpolator can change the rate by any
+ * fraction
+ */
+#define ENV_SAMPLES_PER_BIT	8
+#define ENV_INTERP_TAPS		8
+#if !defined(NATIVE_RATE) && SAMPLES_PER_BIT % ENV_SAMPLES_PER_BIT
+#error "RDS_SAMPLE_RATE must be a multiple of 9500 Hz for a low rate envelope"
+#endif
+#else
+#define ENV_SAMPLES_PER_BIT	SAMPLES_PER_BIT
+#endif
+
+/* a whole number of samples per bit at the bit rate (1187.5 Hz) */
+#define ENV_SAMPLE_RATE		(ENV_SAMPLES_PER_BIT * 2375 / 2)
+#define ENV_FILTER_SIZE		(ENV_SAMPLES_PER_BIT * PULSE_SPAN)
+#define ENV_BUFFER_SIZE		(ENV_SAMPLES_PER_BIT + ENV_FILTER_SIZE)
+
+#if defined(RDS_PREMODULATED) && \
+	(!defined(RDS_SYMBOL_TABLE) || defined(RDS_LOW_RATE_ENVELOPE))
+#error "RDS_PREMODULATED needs RDS_SYMBOL_TABLE at the full rate"
+#endif
+
+#if defined(FIXED_POINT) && \
+	(!defined(RDS_SYMBOL_TABLE) || defined(RDS_LOW_RATE_ENVELOPE))
+#error "FIXED_POINT needs RDS_SYMBOL_TABLE at the full rate"
+#endif
+
+#ifdef RDS_SYMBOL_TABLE
+/*
+ * The biphase pulse spans exactly FILTER_SIZE / SAMPLES_PER_BIT symbols,
+ * so every bit period of the envelope depends only on that many
+ * differentially encoded symbols
+ */
+#define SYMBOL_WINDOW_BITS	(ENV_FILTER_SIZE / ENV_SAMPLES_PER_BIT)
+#define NUM_SYMBOL_WINDOWS	(1 << SYMBOL_WINDOW_BITS)
+#define SYMBOL_WINDOW_MASK	(NUM_SYMBOL_WINDOWS - 1)
+#endif
+
+/*
+ * RDS signal context
+ *
+ * This holds the state of all streams in one contiguous block. Every
+ * stream starts a new bit on the same sample, so they share the bit and
+ * sample counters and advance in lockstep.
+ */
 typedef struct rds_t {
-	uint8_t *bit_buffer; /* BITS_PER_GROUP */
+#ifndef RDS_SYMBOL_TABLE
+	_Alignas(CACHE_LINE_SIZE)
+	float sample_buffer[NUM_STREAMS][ENV_BUFFER_SIZE];
+#else
+	const sample_t *cur_segment[NUM_STREAMS];
+	/* still needed for symbol shifting */
+	const sample_t *prev_segment[NUM_STREAMS];
+#endif
+	/* differentially encoded symbols of the current group */
+	uint64_t group_symbols[NUM_STREAMS][GROUP_WORDS];
+	/*
+	 * The group word being sent, shifted in below the symbols that
+	 * came before it so symbol windows can be read straight out of it
+	 */
+	uint64_t symbols[NUM_STREAMS];
+	/* how many samples each stream lags behind the bit clock */
+	uint16_t symbol_shift[NUM_STREAMS];
+
+	/* shared by all streams */
+	uint8_t num_streams;
 	uint8_t bit_pos;
-	float *sample_buffer; /* SAMPLE_BUFFER_SIZE */
-	uint8_t prev_output;
-	uint8_t cur_output;
-	uint8_t cur_bit;
-	uint8_t sample_count;
+	uint16_t sample_count;
+#ifndef RDS_SYMBOL_TABLE
 	uint16_t in_sample_index;
 	uint16_t out_sample_index;
-	uint8_t symbol_shift;
-	float *symbol_shift_buf;
-	uint8_t symbol_shift_buf_idx;
+#endif
 } rds_t;
 
 extern void init_rds_objects();
 extern void exit_rds_objects();
+extern void set_rds_symbol_shift(uint8_t stream_num, float shift);
+extern void set_rds_streams(uint8_t num_streams);
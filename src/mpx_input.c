@@ -0,0 +1,153 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "fm_mpx.h"
+#include "resampler.h"
+#include "input.h"
+#include "mpx_input.h"
+
+/*
+ * External MPX input
+ *
+ * A composite signal from an audio processor (mono, or the first
+ * channel of a stereo stream) that RDS gets inserted into. It is
+ * brought to the MPX rate if it isn't there already.
+ *
+ */
+
+static bool mpx_in_active;
+
+static struct input_t mpx_in;
+
+static bool resampling;
+static struct resampler_t resampler;
+
+/* one chunk of input */
+static int16_t *in_buffer;
+/* chunk as float */
+static float *chunk_buffer;
+
+/* frames of the chunk not used yet */
+static size_t chunk_pos;
+static size_t chunk_frames;
+
+int8_t open_mpx_input(char *name, uint32_t rate) {
+	if (open_input(&mpx_in, name, rate, 1) < 0) return -1;
+
+	/* from here on close_mpx_input() cleans up */
+	mpx_in_active = true;
+
+	in_buffer = malloc(MPX_INPUT_CHUNK_FRAMES * mpx_in.channels
+		* sizeof(int16_t));
+	chunk_buffer = malloc(MPX_INPUT_CHUNK_FRAMES * sizeof(float));
+	chunk_pos = chunk_frames = 0;
+
+	resampling = mpx_in.rate != MPX_SAMPLE_RATE;
+	if (resampling) {
+		if (resampler_init(&resampler, mpx_in.rate,
+			MPX_SAMPLE_RATE, 1) < 0) {
+			resampling = false;
+			close_mpx_input();
+			return -1;
+		}
+	}
+
+	fprintf(stderr, "MPX input: %s, %u Hz, %u channel(s).\n",
+		name, mpx_in.rate, mpx_in.channels);
+	if (resampling) {
+		fprintf(stderr, "MPX input will be resampled to %u Hz.\n",
+			MPX_SAMPLE_RATE);
+	}
+
+	return 0;
+}
+
+bool mpx_input_active() {
+	return mpx_in_active;
+}
+
+/*
+ * Get the next chunk
+ *
+ */
+static void refill() {
+	uint8_t *bytes = (uint8_t *)in_buffer;
+
+	read_input(&mpx_in, in_buffer, MPX_INPUT_CHUNK_FRAMES);
+
+	for (size_t i = 0; i < MPX_INPUT_CHUNK_FRAMES; i++) {
+		/* input is little endian */
+		chunk_buffer[i] = (int16_t)(bytes[0] | bytes[1] << 8)
+			/ 32768.0f;
+		bytes += mpx_in.channels * sizeof(int16_t);
+	}
+
+	chunk_pos = 0;
+	chunk_frames = MPX_INPUT_CHUNK_FRAMES;
+}
+
+/*
+ * Get a block of MPX samples
+ *
+ * These are resampled straight into the output, and whatever part of
+ * the chunk the resampler doesn't take is kept for the next block.
+ */
+void get_mpx_input_samples(float *out, size_t num_frames) {
+	size_t used, frames;
+
+	while (num_frames) {
+		if (chunk_pos == chunk_frames) refill();
+
+		if (resampling) {
+			if (resample(&resampler, chunk_buffer + chunk_pos,
+				chunk_frames - chunk_pos, &used,
+				out, num_frames, &frames) < 0) {
+				memset(out, 0, num_frames * sizeof(float));
+				return;
+			}
+		} else {
+			frames = chunk_frames - chunk_pos;
+			if (frames > num_frames) frames = num_frames;
+			memcpy(out, chunk_buffer + chunk_pos,
+				frames * sizeof(float));
+			used = frames;
+		}
+
+		chunk_pos += used;
+		out += frames;
+		num_frames -= frames;
+	}
+}
+
+void close_mpx_input() {
+	if (!mpx_in_active) return;
+	mpx_in_active = false;
+
+	close_input(&mpx_in);
+
+	if (resampling) {
+		resampler_exit(&resampler);
+		resampling = false;
+	}
+
+	free(in_buffer);
+	free(chunk_buffer);
+	in_buffer = NULL;
+	chunk_buffer = NULL;
+}
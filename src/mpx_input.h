@@ -0,0 +1,35 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* sample rate of raw or ALSA MPX input when none is given */
+#define DEFAULT_MPX_INPUT_RATE	192000
+
+/* MPX frames read from the input at a time */
+#define MPX_INPUT_CHUNK_FRAMES	1024
+
+/*
+ * Pilot PLL natural frequency and how far (Hz) the pilot may be off
+ * from 19 kHz
+ */
+#define PILOT_PLL_BANDWIDTH	3.0f
+#define PILOT_PLL_MAX_OFFSET	20.0f
+
+extern int8_t open_mpx_input(char *name, uint32_t rate);
+extern bool mpx_input_active();
+extern void get_mpx_input_samples(float *out, size_t num_frames);
+extern void close_mpx_input();
@@ -22,42 +22,67 @@
 /*
  * Code for MPX oscillator
  *
- * This uses lookup tables to speed up the waveform generation
+ * This is a numerically controlled oscillator. The phase of the base
+ * frequency is a 32-bit accumulator that wraps around once per period.
+ * Harmonics of it are at integer multiples of that phase, so all of
+ * them stay locked to each other.
+ *
+ * A whole frequency at an untrimmed rate is kept exact: the step is
+ * rounded down and what it leaves over is carried in a second
+ * accumulator, so for instance 4750 Hz at 228 kHz comes back to the
+ * same phase every 48 samples, like the premodulated RDS table does.
+ *
+ * Waveform samples are linearly interpolated from one small sine table
+ * that is shared by all oscillators. Changing the frequency only
+ * changes the phase step.
  *
  */
 
+/* one period, plus one sample for interpolating the last one */
+static sample_t *sine_table;
+/* number of oscillators using the table */
+static uint8_t table_users;
+
+#define OSC_FRAC_BITS	(32 - OSC_TABLE_BITS)
+#define OSC_FRAC_MASK	((1U << OSC_FRAC_BITS) - 1)
+/* a quarter period in phase units */
+#define OSC_QUARTER	(1U << 30)
+
 /*
  * DDS function generator
  *
- * Create wave constants for a given frequency
  */
-static void create_wave(uint32_t rate, float freq,
-		float *sin_wave, float *cos_wave, uint16_t *max_phase) {
-	double sin_sample, cos_sample;
-	/* used to determine if we have completed a cycle */
-	uint8_t zero_crossings = 0;
-	uint16_t i = 1;
-	const double w = M_2PI * freq;
-	double phase;
-
-	/* First value of a sine wave is always 0 */
-	*sin_wave++ = 0.0f;
-	*cos_wave++ = 1.0f;
-
-	while (zero_crossings < 2 && i < rate) {
-		phase = (double)i / (double)rate;
-		sin_sample = sin(w * phase);
-		cos_sample = cos(w * phase);
-		if (sin_sample > -0.1e-4 && sin_sample < 0.1e-4) {
-			zero_crossings++;
-			sin_sample = 0.0f;
-		}
-		*sin_wave++ = (float)sin_sample;
-		*cos_wave++ = (float)cos_sample;
-		i++;
+static void create_wave() {
+	double sample;
+
+	sine_table = malloc((OSC_TABLE_SIZE + 1) * sizeof(sample_t));
+
+	for (uint16_t i = 0; i < OSC_TABLE_SIZE + 1; i++) {
+		sample = sin(M_2PI * (double)i / OSC_TABLE_SIZE);
+		/* keep the zero crossings exact */
+		if (sample > -0.1e-4 && sample < 0.1e-4) sample = 0.0;
+		sine_table[i] = TO_SAMPLE((float)sample);
+	}
+}
+
+/*
+ * Work out the phase step from the frequency and the trim
+ *
+ */
+static void update_step(struct osc_t *osc) {
+	double rate = osc->sample_rate * (1.0 + osc->ppm * 1e-6);
+	uint64_t num;
+
+	if (osc->ppm == 0.0f && osc->freq == floorf(osc->freq)) {
+		num = (uint64_t)osc->freq << 32;
+		osc->step = (uint32_t)(num / osc->sample_rate);
+		osc->step_rem = (uint32_t)(num % osc->sample_rate);
+		return;
 	}
 
-	*max_phase = i - 1;
+	osc->step = (uint32_t)llround(osc->freq / rate * 4294967296.0);
+	osc->step_rem = 0;
+	osc->rem_acc = 0;
 }
 
 /*
@@ -65,35 +90,71 @@ static void create_wave(uint32_t rate, float freq,
  *
  */
 void osc_init(struct osc_t *osc, uint32_t sample_rate, float freq) {
+	if (table_users++ == 0) create_wave();
 
 	/* sample rate for the objects */
 	osc->sample_rate = sample_rate;
-
-	/* waveform tables */
-	osc->sin_wave = malloc(osc->sample_rate * sizeof(float));
-	osc->cos_wave = malloc(osc->sample_rate * sizeof(float));
+	osc->freq = freq;
+	osc->ppm = 0.0f;
 
 	/* set current position to 0 */
-	osc->cur = 0;
+	osc->phase = 0;
+	osc->rem_acc = 0;
 
-	/* create waveform data and load into lookup tables */
-	create_wave(osc->sample_rate, freq,
-		osc->sin_wave, osc->cos_wave,
-		&osc->max);
+	update_step(osc);
 }
 
 /*
- * Get a single waveform sample
+ * Change the frequency (takes effect on the next sample)
+ *
+ */
+void osc_set_freq(struct osc_t *osc, float freq) {
+	osc->freq = freq;
+	update_step(osc);
+}
+
+/*
+ * Trim for a sample clock that is off by ppm parts per million
+ *
+ * A positive value means the sample clock runs fast, so the phase step
+ * is made smaller to keep the output on frequency
+ */
+void osc_set_ppm(struct osc_t *osc, float ppm) {
+	osc->ppm = ppm;
+	update_step(osc);
+}
+
+/*
+ * Interpolate the sine table at a phase
+ *
+ */
+static inline sample_t get_sample(uint32_t phase) {
+	const sample_t *s = sine_table + (phase >> OSC_FRAC_BITS);
+#ifdef FIXED_POINT
+	/* top 15 bits of the fraction */
+	int32_t frac = (phase & OSC_FRAC_MASK) >> (OSC_FRAC_BITS - 15);
+
+	return s[0] + (((s[1] - s[0]) * frac) >> 15);
+#else
+	float frac = (phase & OSC_FRAC_MASK) * (1.0f / (OSC_FRAC_MASK + 1.0f));
+
+	return s[0] + (s[1] - s[0]) * frac;
+#endif
+}
+
+/*
+ * Get a single waveform sample of a harmonic
  *
  * Cosine is needed for SSB generation
  *
  */
-float osc_get_cos(struct osc_t *osc) {
-	return osc->cos_wave[osc->cur];
+sample_t osc_get_cos(struct osc_t *osc, uint8_t harmonic) {
+	/* a quarter period ahead */
+	return get_sample(osc->phase * harmonic + OSC_QUARTER);
 }
 
-float osc_get_sin(struct osc_t *osc) {
-	return osc->sin_wave[osc->cur];
+sample_t osc_get_sin(struct osc_t *osc, uint8_t harmonic) {
+	return get_sample(osc->phase * harmonic);
 }
 
 /*
@@ -101,16 +162,28 @@ float osc_get_sin(struct osc_t *osc) {
  *
  */
 void osc_update_pos(struct osc_t *osc) {
-	if (++osc->cur == osc->max) osc->cur = 0;
+	/* wraps around at the end of the period */
+	osc->phase += osc->step;
+
+	osc->rem_acc += osc->step_rem;
+	if (osc->rem_acc >= osc->sample_rate) {
+		osc->rem_acc -= osc->sample_rate;
+		osc->phase++;
+	}
 }
 
 /*
- * Unload waveform tables
+ * Release the waveform table once the last oscillator is done
  *
  */
 void osc_exit(struct osc_t *osc) {
-	free(osc->sin_wave);
-	free(osc->cos_wave);
-	osc->cur = 0;
-	osc->max = 0;
+	osc->phase = 0;
+	osc->step = 0;
+	osc->step_rem = 0;
+	osc->rem_acc = 0;
+
+	if (table_users && --table_users == 0) {
+		free(sine_table);
+		sine_table = NULL;
+	}
 }
@@ -16,35 +16,48 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/* sine table size (power of 2) */
+#define OSC_TABLE_BITS	10
+#define OSC_TABLE_SIZE	(1 << OSC_TABLE_BITS)
+
 /* context for MPX oscillator */
 typedef struct osc_t {
 	/* the sample rate at which the oscillator operates */
 	uint32_t sample_rate;
 
 	/*
-	 * frequency for this instance
+	 * base frequency for this instance
 	 *
 	 */
 	float freq;
 
 	/*
-	 * Arrays of carrier wave constants
+	 * sample clock trim in parts per million
+	 *
+	 */
+	float ppm;
+
+	/*
+	 * Wave phase of the base frequency (a full period is 2^32)
 	 *
 	 */
-	float *sin_wave;
-	float *cos_wave;
+	uint32_t phase;
+	uint32_t step;
 
 	/*
-	 * Wave phase
+	 * What the step leaves over, in 1/sample_rate of a phase unit,
+	 * so that whole frequencies come out exact in the long run
 	 *
 	 */
-	uint16_t cur;
-	uint16_t max;
+	uint32_t step_rem;
+	uint32_t rem_acc;
 } osc_t;
 
 extern void osc_init(struct osc_t *osc, uint32_t sample_rate,
 	const float freq);
-extern float osc_get_sin(struct osc_t *osc);
-extern float osc_get_cos(struct osc_t *osc);
+extern void osc_set_freq(struct osc_t *osc, float freq);
+extern void osc_set_ppm(struct osc_t *osc, float ppm);
+extern sample_t osc_get_sin(struct osc_t *osc, uint8_t harmonic);
+extern sample_t osc_get_cos(struct osc_t *osc, uint8_t harmonic);
 extern void osc_update_pos(struct osc_t *osc);
 extern void osc_exit(struct osc_t *osc);
@@ -0,0 +1,603 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include <ao/ao.h>
+#ifdef ALSA_OUTPUT
+#include <errno.h>
+#include <alsa/asoundlib.h>
+#endif
+
+#include "fm_mpx.h"
+#include "output.h"
+
+/*
+ * Output backends
+ *
+ * The mono MPX signal is converted to the sample format of the backend
+ * and copied to all of its channels. Backends that take the format of
+ * the signal path on one channel get the samples as they are.
+ *
+ */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define HOST_LITTLE_ENDIAN
+#endif
+
+static char *format_names[OUTPUT_FORMAT_END] = {
+	"s16", "s24", "s32", "float"
+};
+
+static const uint8_t format_bytes[OUTPUT_FORMAT_END] = {
+	2, 3, 4, 4
+};
+
+static inline void put_le16(uint8_t *p, uint16_t x) {
+	p[0] = x & 255;
+	p[1] = x >> 8;
+}
+
+static inline void put_le24(uint8_t *p, uint32_t x) {
+	p[0] = x & 255;
+	p[1] = (x >> 8) & 255;
+	p[2] = (x >> 16) & 255;
+}
+
+static inline void put_le32(uint8_t *p, uint32_t x) {
+	p[0] = x & 255;
+	p[1] = (x >> 8) & 255;
+	p[2] = (x >> 16) & 255;
+	p[3] = x >> 24;
+}
+
+/* clip to full scale, the limiter should have done that already */
+static inline float clip(float x) {
+	if (x > 1.0f) return 1.0f;
+	if (x < -1.0f) return -1.0f;
+	return x;
+}
+
+static void convert_samples(struct output_t *out, const sample_t *in,
+	uint8_t *buf, size_t frames) {
+	uint8_t size = format_bytes[out->format];
+	float f;
+	uint32_t bits;
+
+	for (size_t i = 0; i < frames; i++) {
+		switch (out->format) {
+		case OUTPUT_FORMAT_S16:
+#ifdef FIXED_POINT
+			put_le16(buf, in[i]);
+#else
+			put_le16(buf, lroundf(clip(in[i]) * 32767.0f));
+#endif
+			break;
+		case OUTPUT_FORMAT_S24:
+#ifdef FIXED_POINT
+			put_le24(buf, (uint32_t)in[i] << 8);
+#else
+			put_le24(buf, lroundf(clip(in[i]) * 8388607.0f));
+#endif
+			break;
+		case OUTPUT_FORMAT_S32:
+#ifdef FIXED_POINT
+			put_le32(buf, (uint32_t)in[i] << 16);
+#else
+			put_le32(buf, lround(clip(in[i]) * 2147483647.0));
+#endif
+			break;
+		case OUTPUT_FORMAT_FLOAT:
+			f = FROM_SAMPLE(in[i]);
+			memcpy(&bits, &f, 4);
+			put_le32(buf, bits);
+			break;
+		}
+
+		/* the same on every channel */
+		for (uint8_t c = 1; c < out->channels; c++)
+			memcpy(buf + c * size, buf, size);
+
+		buf += out->frame_size;
+	}
+}
+
+/* libao */
+static int8_t open_ao(struct output_t *out, char *target) {
+	ao_sample_format format;
+	int driver;
+
+	if (out->format == OUTPUT_FORMAT_FLOAT) {
+		fprintf(stderr, "Error: libao does not take float samples.\n");
+		return -1;
+	}
+
+	memset(&format, 0, sizeof(struct ao_sample_format));
+	format.channels = out->channels;
+	format.bits = format_bytes[out->format] * 8;
+	format.rate = out->rate;
+	format.byte_format = AO_FMT_LITTLE;
+
+	ao_initialize();
+
+	driver = target ? ao_driver_id(target) : ao_default_driver_id();
+	if (driver < 0) {
+		fprintf(stderr, "Error: unknown libao driver %s.\n", target);
+		ao_shutdown();
+		return -1;
+	}
+
+	out->dev = ao_open_live(driver, &format, NULL);
+	if (out->dev == NULL) {
+		fprintf(stderr, "Error: cannot open sound device.\n");
+		ao_shutdown();
+		return -1;
+	}
+
+	return 0;
+}
+
+static int8_t write_ao(struct output_t *out, const void *buf, size_t frames) {
+	if (!ao_play(out->dev, (char *)buf, frames * out->frame_size)) {
+		fprintf(stderr, "Error: could not play audio.\n");
+		return -1;
+	}
+	return 0;
+}
+
+static void close_ao(struct output_t *out) {
+	ao_close(out->dev);
+	ao_shutdown();
+}
+
+/* raw samples to a file or stdout */
+static int8_t open_raw(struct output_t *out, char *target) {
+	if (target == NULL || strcmp(target, "-") == 0) {
+		out->file = stdout;
+		return 0;
+	}
+
+	out->file = fopen(target, "wb");
+	if (out->file == NULL) {
+		fprintf(stderr, "Error: could not open %s.\n", target);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int8_t write_file(struct output_t *out, const void *buf,
+	size_t frames) {
+	if (fwrite(buf, out->frame_size, frames, out->file) != frames) {
+		fprintf(stderr, "Error: could not write to %s.\n",
+			out->target ? out->target : "stdout");
+		return -1;
+	}
+	out->data_bytes += frames * out->frame_size;
+	return 0;
+}
+
+static void close_raw(struct output_t *out) {
+	if (out->file != stdout) fclose(out->file);
+}
+
+/*
+ * WAV file
+ *
+ * The sizes in the header are as large as they go until the file is
+ * closed, so it can be read while it is written (or from stdout)
+ */
+static void write_wav_header(struct output_t *out, uint32_t data_size) {
+	uint8_t hdr[44];
+	uint8_t bytes = format_bytes[out->format];
+
+	memcpy(hdr, "RIFF", 4);
+	put_le32(hdr + 4, data_size + 36);
+	memcpy(hdr + 8, "WAVEfmt ", 8);
+	put_le32(hdr + 16, 16);
+	/* PCM or IEEE float */
+	put_le16(hdr + 20, out->format == OUTPUT_FORMAT_FLOAT ? 3 : 1);
+	put_le16(hdr + 22, out->channels);
+	put_le32(hdr + 24, out->rate);
+	put_le32(hdr + 28, out->rate * out->frame_size);
+	put_le16(hdr + 32, out->frame_size);
+	put_le16(hdr + 34, bytes * 8);
+	memcpy(hdr + 36, "data", 4);
+	put_le32(hdr + 40, data_size);
+
+	fwrite(hdr, 1, 44, out->file);
+}
+
+static int8_t open_wav(struct output_t *out, char *target) {
+	if (target == NULL) {
+		fprintf(stderr, "Error: WAV output needs a file name.\n");
+		return -1;
+	}
+
+	if (open_raw(out, target) < 0) return -1;
+
+	write_wav_header(out, UINT32_MAX - 36);
+	return 0;
+}
+
+static void close_wav(struct output_t *out) {
+	uint64_t size = out->data_bytes;
+
+	if (size > UINT32_MAX - 36) size = UINT32_MAX - 36;
+
+	/* put in the real sizes if the file can be rewound */
+	if (out->file != stdout && fseek(out->file, 0, SEEK_SET) == 0)
+		write_wav_header(out, size);
+
+	close_raw(out);
+}
+
+/* null sink, takes everything right away */
+static int8_t open_null(struct output_t *out, char *target) {
+	(void)out;
+	(void)target;
+	return 0;
+}
+
+static int8_t write_null(struct output_t *out, const void *buf,
+	size_t frames) {
+	(void)out;
+	(void)buf;
+	(void)frames;
+	return 0;
+}
+
+static int32_t null_latency(struct output_t *out) {
+	(void)out;
+	return 0;
+}
+
+#ifdef ALSA_OUTPUT
+/*
+ * ALSA playback straight into the mmapped device buffer
+ *
+ * The period and buffer sizes are ours to choose, so the latency is
+ * known and can be kept low
+ */
+static const snd_pcm_format_t alsa_formats[OUTPUT_FORMAT_END] = {
+	SND_PCM_FORMAT_S16_LE,
+	SND_PCM_FORMAT_S24_3LE,
+	SND_PCM_FORMAT_S32_LE,
+	SND_PCM_FORMAT_FLOAT_LE
+};
+
+static int8_t alsa_recover(struct output_t *out, int err) {
+	if (err == -EPIPE) fprintf(stderr, "Output underrun.\n");
+
+	err = snd_pcm_recover(out->dev, err, 1);
+	if (err < 0) {
+		fprintf(stderr, "Error: could not play audio: %s\n",
+			snd_strerror(err));
+		return -1;
+	}
+	return 0;
+}
+
+static int8_t open_alsa(struct output_t *out, char *target) {
+	char *device = target ? target : "default";
+	snd_pcm_t *pcm;
+	snd_pcm_hw_params_t *hw;
+	snd_pcm_sw_params_t *sw;
+	snd_pcm_uframes_t period = out->block_frames;
+	snd_pcm_uframes_t buffer;
+	int dir = 0;
+	int err;
+
+	buffer = out->buffer_frames ? out->buffer_frames :
+		period * ALSA_PERIODS;
+
+	err = snd_pcm_open(&pcm, device, SND_PCM_STREAM_PLAYBACK, 0);
+	if (err < 0) {
+		fprintf(stderr, "Error: could not open %s: %s\n",
+			device, snd_strerror(err));
+		return -1;
+	}
+
+	snd_pcm_hw_params_malloc(&hw);
+	snd_pcm_hw_params_any(pcm, hw);
+	if ((err = snd_pcm_hw_params_set_access(pcm, hw,
+			SND_PCM_ACCESS_MMAP_INTERLEAVED)) < 0 ||
+		(err = snd_pcm_hw_params_set_format(pcm, hw,
+			alsa_formats[out->format])) < 0 ||
+		(err = snd_pcm_hw_params_set_channels(pcm, hw,
+			out->channels)) < 0 ||
+		(err = snd_pcm_hw_params_set_rate(pcm, hw,
+			out->rate, 0)) < 0 ||
+		(err = snd_pcm_hw_params_set_period_size_near(pcm, hw,
+			&period, &dir)) < 0 ||
+		(err = snd_pcm_hw_params_set_buffer_size_near(pcm, hw,
+			&buffer)) < 0 ||
+		(err = snd_pcm_hw_params(pcm, hw)) < 0) {
+		fprintf(stderr, "Error: could not set up %s: %s\n",
+			device, snd_strerror(err));
+		snd_pcm_hw_params_free(hw);
+		snd_pcm_close(pcm);
+		return -1;
+	}
+	snd_pcm_hw_params_free(hw);
+
+	/* what the device went with */
+	snd_pcm_get_params(pcm, &buffer, &period);
+
+	/* start once the buffer is full and wake up for every period */
+	snd_pcm_sw_params_malloc(&sw);
+	snd_pcm_sw_params_current(pcm, sw);
+	snd_pcm_sw_params_set_start_threshold(pcm, sw, buffer);
+	snd_pcm_sw_params_set_avail_min(pcm, sw, period);
+	err = snd_pcm_sw_params(pcm, sw);
+	snd_pcm_sw_params_free(sw);
+	if (err < 0) {
+		fprintf(stderr, "Error: could not set up %s: %s\n",
+			device, snd_strerror(err));
+		snd_pcm_close(pcm);
+		return -1;
+	}
+
+	out->dev = pcm;
+	out->block_frames = period;
+	out->buffer_frames = buffer;
+
+	fprintf(stderr, "ALSA period %lu frames, buffer %lu frames "
+		"(%.1f ms).\n", period, buffer, buffer * 1000.0 / out->rate);
+
+	return 0;
+}
+
+/*
+ * Wait for room in the device buffer and map it
+ *
+ * Until the device is started whatever fits is taken, after that it is
+ * up to a period at a time
+ */
+static void *alsa_begin(struct output_t *out, size_t *frames) {
+	snd_pcm_t *pcm = out->dev;
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t offset, n;
+	snd_pcm_sframes_t avail;
+	size_t want = *frames < out->block_frames ?
+		*frames : out->block_frames;
+	int err;
+
+	for (;;) {
+		avail = snd_pcm_avail_update(pcm);
+		if (avail < 0) {
+			if (alsa_recover(out, (int)avail) < 0) return NULL;
+			continue;
+		}
+
+		if ((size_t)avail < want && !(avail > 0 &&
+			snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED)) {
+			err = snd_pcm_wait(pcm, ALSA_TIMEOUT_MS);
+			if (err == 0) {
+				fprintf(stderr, "Error: the sound card "
+					"stopped taking samples.\n");
+				return NULL;
+			}
+			if (err < 0 && alsa_recover(out, err) < 0)
+				return NULL;
+			continue;
+		}
+
+		n = (size_t)avail < *frames ? (size_t)avail : *frames;
+		err = snd_pcm_mmap_begin(pcm, &areas, &offset, &n);
+		if (err == 0) break;
+		if (alsa_recover(out, err) < 0) return NULL;
+	}
+
+	/* interleaved, so the frames follow each other from channel 0 */
+	out->mmap_offset = offset;
+	*frames = n;
+	return (uint8_t *)areas[0].addr + areas[0].first / 8 +
+		offset * (areas[0].step / 8);
+}
+
+static int8_t alsa_commit(struct output_t *out, const void *buf,
+	size_t frames) {
+	snd_pcm_sframes_t r;
+
+	(void)buf;
+
+	r = snd_pcm_mmap_commit(out->dev, out->mmap_offset, frames);
+	if (r < 0 || (size_t)r != frames)
+		return alsa_recover(out, r < 0 ? (int)r : -EPIPE);
+	return 0;
+}
+
+/* frames between what is written and what the DAC is putting out */
+static int32_t alsa_latency(struct output_t *out) {
+	snd_pcm_sframes_t delay;
+
+	if (snd_pcm_delay(out->dev, &delay) < 0) return -1;
+	return delay;
+}
+
+static void close_alsa(struct output_t *out) {
+	snd_pcm_drain(out->dev);
+	snd_pcm_close(out->dev);
+}
+#endif
+
+static const struct output_backend_t backends[] = {
+	{
+		.name = "ao",
+		.format = OUTPUT_FORMAT_S16,
+		.channels = OUTPUT_CHANNELS,
+		.block_frames = NUM_MPX_FRAMES_OUT,
+		.realtime = true,
+		.open = open_ao,
+		.commit = write_ao,
+		.close = close_ao
+	},
+#ifdef ALSA_OUTPUT
+	{
+		.name = "alsa",
+		.format = OUTPUT_FORMAT_S16,
+		.channels = OUTPUT_CHANNELS,
+		.block_frames = ALSA_PERIOD_FRAMES,
+		.realtime = true,
+		.open = open_alsa,
+		.begin = alsa_begin,
+		.commit = alsa_commit,
+		.latency = alsa_latency,
+		.close = close_alsa
+	},
+#endif
+	{
+		.name = "raw",
+		.format = OUTPUT_FORMAT_NATIVE,
+		.channels = 1,
+		.block_frames = OUTPUT_FILE_BLOCK_FRAMES,
+		.open = open_raw,
+		.commit = write_file,
+		.close = close_raw
+	},
+	{
+		.name = "wav",
+		.format = OUTPUT_FORMAT_NATIVE,
+		.channels = 1,
+		.block_frames = OUTPUT_FILE_BLOCK_FRAMES,
+		.open = open_wav,
+		.commit = write_file,
+		.close = close_wav
+	},
+	{
+		.name = "null",
+		.format = OUTPUT_FORMAT_NATIVE,
+		.channels = 1,
+		.block_frames = OUTPUT_FILE_BLOCK_FRAMES,
+		.open = open_null,
+		.commit = write_null,
+		.latency = null_latency
+	},
+	{ .name = NULL }
+};
+
+/* sample format from its name, -1 if there is no such format */
+int8_t get_output_format(char *name) {
+	for (uint8_t i = 0; i < OUTPUT_FORMAT_END; i++) {
+		if (strcmp(name, format_names[i]) == 0) return i;
+	}
+	return -1;
+}
+
+/*
+ * Open an output
+ *
+ * The name is the backend, optionally followed by a colon and where it
+ * writes to (e.g. "wav:mpx.wav"). A format of -1 is the one the backend
+ * takes best, and a period (frames per write) or buffer size of 0 is
+ * the backend's own.
+ */
+int8_t open_output(struct output_t *out, char *name, uint32_t rate,
+	int8_t format, size_t period, size_t buffer) {
+	size_t len;
+	char *target;
+
+	memset(out, 0, sizeof(struct output_t));
+
+	target = strchr(name, ':');
+	len = target ? (size_t)(target - name) : strlen(name);
+	if (target) target++;
+
+	for (uint8_t i = 0; backends[i].name; i++) {
+		if (strlen(backends[i].name) == len &&
+			strncmp(name, backends[i].name, len) == 0) {
+			out->backend = &backends[i];
+			break;
+		}
+	}
+
+	if (out->backend == NULL) {
+		fprintf(stderr, "Error: unknown output %s.\n", name);
+		return -1;
+	}
+
+	out->target = target;
+	out->format = format < 0 ? out->backend->format : format;
+	out->channels = out->backend->channels;
+	out->rate = rate;
+	out->frame_size = format_bytes[out->format] * out->channels;
+	out->block_frames = period ? period : out->backend->block_frames;
+	out->buffer_frames = buffer;
+
+	if (out->backend->open(out, target) < 0) {
+		out->backend = NULL;
+		return -1;
+	}
+
+#ifdef HOST_LITTLE_ENDIAN
+	out->direct = out->format == OUTPUT_FORMAT_NATIVE &&
+		out->channels == 1;
+#endif
+
+	if (!out->backend->begin && !out->direct)
+		out->buffer = malloc(out->block_frames * out->frame_size);
+
+	fprintf(stderr, "Output: %s (%s, %u channel%s, %u Hz).\n",
+		name, format_names[out->format], out->channels,
+		out->channels == 1 ? "" : "s", out->rate);
+
+	return 0;
+}
+
+int8_t write_output(struct output_t *out, const sample_t *in,
+	size_t frames) {
+	const struct output_backend_t *backend = out->backend;
+	void *buf;
+	size_t n;
+
+	while (frames) {
+		n = frames;
+
+		if (backend->begin) {
+			buf = backend->begin(out, &n);
+			if (buf == NULL) return -1;
+			convert_samples(out, in, buf, n);
+		} else if (out->direct) {
+			buf = (void *)in;
+		} else {
+			if (n > out->block_frames) n = out->block_frames;
+			buf = out->buffer;
+			convert_samples(out, in, buf, n);
+		}
+
+		if (backend->commit(out, buf, n) < 0) return -1;
+
+		in += n;
+		frames -= n;
+	}
+
+	return 0;
+}
+
+int32_t get_output_latency(struct output_t *out) {
+	if (out->backend->latency == NULL) return -1;
+	return out->backend->latency(out);
+}
+
+void close_output(struct output_t *out) {
+	if (out->backend == NULL) return;
+
+	if (out->backend->close) out->backend->close(out);
+	free(out->buffer);
+	out->backend = NULL;
+}
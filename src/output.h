@@ -0,0 +1,120 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* where the MPX signal goes unless told otherwise */
+#define DEFAULT_OUTPUT		"ao"
+
+/* frames per write for the file backends */
+#define OUTPUT_FILE_BLOCK_FRAMES	4096
+
+#ifdef ALSA_OUTPUT
+/*
+ * ALSA period (frames per write) and the number of periods in the
+ * buffer, 2048 frames or about 11 ms at 192 kHz
+ */
+#define ALSA_PERIOD_FRAMES	512
+#define ALSA_PERIODS		4
+
+/* how long to wait for the sound card to take samples (ms) */
+#define ALSA_TIMEOUT_MS		1000
+#endif
+
+/* sample formats (little endian) */
+enum output_formats {
+	OUTPUT_FORMAT_S16,
+	OUTPUT_FORMAT_S24,	/* packed in 3 bytes */
+	OUTPUT_FORMAT_S32,
+	OUTPUT_FORMAT_FLOAT,
+	OUTPUT_FORMAT_END
+};
+
+/* the format of the signal path, which needs no conversion */
+#ifdef FIXED_POINT
+#define OUTPUT_FORMAT_NATIVE	OUTPUT_FORMAT_S16
+#else
+#define OUTPUT_FORMAT_NATIVE	OUTPUT_FORMAT_FLOAT
+#endif
+
+struct output_t;
+
+/* a place the MPX signal can go */
+typedef struct output_backend_t {
+	char *name;
+
+	/* what it takes best, used unless told otherwise */
+	uint8_t format;
+	uint8_t channels;
+	size_t block_frames;
+
+	/* writes wait for a sample clock (a sound card) */
+	bool realtime;
+
+	int8_t (*open)(struct output_t *out, char *target);
+
+	/*
+	 * Where the next frames go (up to *frames of them), for backends
+	 * with a buffer of their own. Others get the frames converted in
+	 * a buffer of the output, or straight from the signal path.
+	 */
+	void *(*begin)(struct output_t *out, size_t *frames);
+
+	/* hand over frames that are in the backend's format */
+	int8_t (*commit)(struct output_t *out, const void *buf, size_t frames);
+
+	/* frames written that haven't been played yet (-1 if unknown) */
+	int32_t (*latency)(struct output_t *out);
+
+	void (*close)(struct output_t *out);
+} output_backend_t;
+
+/* an open output */
+typedef struct output_t {
+	const struct output_backend_t *backend;
+	char *target;
+
+	uint8_t format;
+	uint8_t channels;
+	uint32_t rate;
+	uint8_t frame_size;
+	size_t block_frames;
+	/* device buffer (ALSA) */
+	size_t buffer_frames;
+
+	/* frames in the signal path format can be handed over as they are */
+	bool direct;
+
+	/* converted frames for backends without a buffer of their own */
+	uint8_t *buffer;
+
+	/* raw and WAV files */
+	FILE *file;
+	uint64_t data_bytes;
+
+	/* libao device (ao_device) or ALSA PCM (snd_pcm_t) */
+	void *dev;
+	/* where the frames from begin are in the mmapped buffer */
+	size_t mmap_offset;
+} output_t;
+
+extern int8_t get_output_format(char *name);
+extern int8_t open_output(struct output_t *out, char *name, uint32_t rate,
+	int8_t format, size_t period, size_t buffer);
+extern int8_t write_output(struct output_t *out, const sample_t *in,
+	size_t frames);
+extern int32_t get_output_latency(struct output_t *out);
+extern void close_output(struct output_t *out);
@@ -0,0 +1,96 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "pll.h"
+
+/*
+ * Phase-locked loop
+ *
+ * The input is mixed with the cosine and negative sine of the local
+ * oscillator and summed over a whole block. That sum already filters
+ * out the mixing products and most of whatever else is in the input,
+ * so the phase error only has to be worked out (and the loop filter
+ * run) once per block. The oscillator itself is owned by the caller,
+ * which applies the returned frequency correction for the next block.
+ *
+ */
+
+/*
+ * Second order loop with a damping factor of 0.707 and the natural
+ * frequency given as the bandwidth (Hz)
+ */
+void pll_init(struct pll_t *pll, uint32_t sample_rate,
+	float bandwidth, float max_offset) {
+	float wn = M_2PI * bandwidth;
+
+	memset(pll, 0, sizeof(struct pll_t));
+	pll->sample_rate = sample_rate;
+	pll->kp = 2.0f * 0.707f * wn;
+	pll->ki = wn * wn;
+	pll->max_correction = M_2PI * max_offset;
+}
+
+/*
+ * Measure the phase of the input against the oscillator and update
+ * the frequency correction
+ *
+ * Returns how far (Hz) the oscillator should be moved from its
+ * nominal frequency
+ */
+float pll_update(struct pll_t *pll, const float *in,
+	const float *ref_cos, const float *ref_msin, size_t num_frames) {
+	float i_sum = 0.0f, q_sum = 0.0f;
+	float block_time;
+	double correction;
+
+	if (num_frames == 0) return pll->offset;
+
+	for (size_t k = 0; k < num_frames; k++) {
+		i_sum += in[k] * ref_cos[k];
+		q_sum += in[k] * ref_msin[k];
+	}
+
+	/* mixing leaves half the amplitude */
+	pll->level = 2.0f * sqrtf(i_sum * i_sum + q_sum * q_sum) / num_frames;
+	if (pll->level < PLL_MIN_LEVEL) {
+		pll->locked = false;
+		return pll->offset;
+	}
+
+	pll->error = atan2f(q_sum, i_sum);
+	pll->locked = fabsf(pll->error) <
+		(pll->locked ? PLL_UNLOCK_ERROR : PLL_LOCK_ERROR);
+
+	/* loop filter */
+	block_time = (float)num_frames / pll->sample_rate;
+	pll->integrator += pll->ki * pll->error * block_time;
+	if (pll->integrator > +pll->max_correction)
+		pll->integrator = +pll->max_correction;
+	if (pll->integrator < -pll->max_correction)
+		pll->integrator = -pll->max_correction;
+
+	correction = pll->integrator + pll->kp * pll->error;
+	if (correction > +pll->max_correction)
+		correction = +pll->max_correction;
+	if (correction < -pll->max_correction)
+		correction = -pll->max_correction;
+
+	pll->offset = (float)(correction / M_2PI);
+	return pll->offset;
+}
@@ -0,0 +1,56 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Reference levels (peak) below this are treated as missing and the
+ * loop holds its last frequency
+ */
+#define PLL_MIN_LEVEL		0.01f
+
+/*
+ * Phase error (radians) under which the loop counts as locked and over
+ * which it counts as unlocked again
+ */
+#define PLL_LOCK_ERROR		0.1f
+#define PLL_UNLOCK_ERROR	0.3f
+
+/* context for a block based phase-locked loop */
+typedef struct pll_t {
+	uint32_t sample_rate;
+
+	/* loop filter (proportional and integral gain) */
+	float kp;
+	float ki;
+	double integrator;
+
+	/* largest frequency correction (rad/s) */
+	float max_correction;
+
+	/* frequency correction in Hz */
+	float offset;
+
+	/* measured reference level and phase error */
+	float level;
+	float error;
+	bool locked;
+} pll_t;
+
+extern void pll_init(struct pll_t *pll, uint32_t sample_rate,
+	float bandwidth, float max_offset);
+extern float pll_update(struct pll_t *pll, const float *in,
+	const float *ref_cos, const float *ref_msin, size_t num_frames);
@@ -516,7 +516,7 @@ group_coded:
 	}
 }
 
-void get_rds_bits(uint8_t *bits) {
+void get_rds_bits(uint64_t *bits) {
 	static uint16_t out_blocks[GROUP_LENGTH];
 	get_rds_group(out_blocks);
 #ifdef RDS2
@@ -28,10 +28,33 @@
 
 #define GROUP_LENGTH		4
 #define BITS_PER_GROUP		(GROUP_LENGTH * (BLOCK_SIZE + POLY_DEG))
+/*
+ * Groups are passed around packed into words of two blocks each
+ * (first bit in the most significant position)
+ */
+#define GROUP_WORDS		2
+#define BLOCKS_PER_GROUP_WORD	(GROUP_LENGTH / GROUP_WORDS)
+#define BITS_PER_GROUP_WORD	(BITS_PER_GROUP / GROUP_WORDS)
+#define GROUP_WORD_MASK		((UINT64_C(1) << BITS_PER_GROUP_WORD) - 1)
+
+/*
+ * The sample rate the RDS signal is generated at
+ *
+ * This must be a multiple of the bit rate (1187.5 Hz) so that every bit
+ * is a whole number of samples long
+ */
+#ifndef RDS_SAMPLE_RATE
 #define RDS_SAMPLE_RATE		190000
-#define SAMPLES_PER_BIT		160
-#define FILTER_SIZE		1120
-#define SAMPLE_BUFFER_SIZE	(SAMPLES_PER_BIT + FILTER_SIZE)
+#endif
+#define RDS_BIT_RATE		1187.5
+#define SAMPLES_PER_BIT		(RDS_SAMPLE_RATE * 2 / 2375)
+#if RDS_SAMPLE_RATE * 2 % 2375
+#error "RDS_SAMPLE_RATE must be a multiple of 1187.5 Hz"
+#endif
+
+/* number of bit periods the pulse shape spans */
+#define PULSE_SPAN		7
+#define FILTER_SIZE		(SAMPLES_PER_BIT * PULSE_SPAN)
 
 /* Text items
  *
@@ -288,7 +311,7 @@ typedef struct rds_oda_t {
 
 extern void init_rds_encoder(struct rds_params_t rds_params);
 extern void exit_rds_encoder();
-extern void get_rds_bits(uint8_t *bits);
+extern void get_rds_bits(uint64_t *bits);
 extern void set_rds_pi(uint16_t pi_code);
 extern void set_rds_ecc(uint8_t ecc);
 extern void set_rds_rt(unsigned char *rt);
@@ -308,6 +331,6 @@ extern void set_rds_tp(uint8_t tp);
 extern void set_rds_ms(uint8_t ms);
 extern void set_rds_ct(uint8_t ct);
 extern void set_rds_di(uint8_t di);
-extern float get_rds_sample(uint8_t stream_num);
+extern void get_rds_samples(sample_t *buf, size_t num_samples);
 
 #endif /* RDS_H */
@@ -431,7 +431,7 @@ static void get_rds2_group(uint8_t stream_num, uint16_t *blocks) {
 #endif
 }
 
-void get_rds2_bits(uint8_t stream, uint8_t *bits) {
+void get_rds2_bits(uint8_t stream, uint64_t *bits) {
 	static uint16_t out_blocks[GROUP_LENGTH];
 	get_rds2_group(stream, out_blocks);
 	add_checkwords(out_blocks, bits, true);
@@ -66,6 +66,6 @@ typedef struct rft_t {
 	uint16_t *crcs;
 } rft_t;
 
-extern void get_rds2_bits(uint8_t stream_num, uint8_t *bits);
+extern void get_rds2_bits(uint8_t stream_num, uint64_t *bits);
 extern void init_rds2_encoder(char *station_logo_path);
 extern void exit_rds2_encoder();
@@ -18,35 +18,335 @@
 
 #include "common.h"
 #include "resampler.h"
+#ifdef BUILTIN_RESAMPLER
+#include "simd.h"
 
-int8_t resampler_init(SRC_STATE **src_state, uint8_t channels) {
+/*
+ * Polyphase resampler
+ *
+ * Converts between two fixed rates whose ratio is a fraction in lowest
+ * terms (96/95 for 190 kHz to 192 kHz). The input is notionally
+ * upsampled by the numerator, low-pass filtered and decimated by the
+ * denominator, but only the one filter phase that lands on each output
+ * sample is ever computed, as an inner product with the input history.
+ *
+ */
+
+/* filter length of each phase and Kaiser window beta for each quality */
+static const struct {
+	uint16_t taps;
+	double beta;
+} quality_levels[] = {
+	{ 16,  6.0 },	/* fast (~60 dB stopband) */
+	{ 32,  9.0 },	/* medium (~90 dB stopband) */
+	{ 64, 12.0 }	/* best (~120 dB stopband) */
+};
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+	uint32_t t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/* zeroth order modified Bessel function of the first kind */
+static double bessel_i0(double x) {
+	double sum = 1.0, term = 1.0;
+
+	for (uint8_t k = 1; k < 50; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+
+	return sum;
+}
+
+/*
+ * Design the prototype low-pass filter (Kaiser windowed sinc) at the
+ * upsampled rate and split it into phases
+ *
+ * The cutoff is at the Nyquist frequency of the lower of the two rates.
+ * Tap t of phase p is sample t * phases + p of the prototype, which is
+ * stored in reverse as it multiplies the t-th newest input sample.
+ * The extra phase at the end runs one sample past the prototype.
+ */
+static void design_filter(struct resampler_t *rs, double beta) {
+	uint32_t len = (uint32_t)rs->phases * rs->taps;
+	double center = (len - 1) / 2.0;
+	double cutoff, x, r, window, sinc, sum = 0.0;
+	uint32_t i;
+
+	cutoff = rs->decimation > rs->phases ?
+		(double)rs->phases / rs->decimation : 1.0;
+
+	for (uint32_t p = 0; p <= rs->phases; p++) {
+		for (uint16_t t = 0; t < rs->taps; t++) {
+			i = (uint32_t)t * rs->phases + p;
+			if (i >= len) {
+				rs->coeffs[p * rs->taps + rs->taps - 1 - t] = 0.0f;
+				continue;
+			}
+
+			x = (i - center) / rs->phases * cutoff;
+			sinc = x == 0.0 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+			r = (i - center) / (center + 1.0);
+			window = bessel_i0(beta * sqrt(1.0 - r * r))
+				/ bessel_i0(beta);
+
+			rs->coeffs[p * rs->taps + rs->taps - 1 - t] =
+				(float)(sinc * window);
+			if (p < rs->phases) sum += sinc * window;
+		}
+	}
+
+	/* unity gain: each phase adds up to about 1 */
+	for (i = 0; i < len + rs->taps; i++) {
+		rs->coeffs[i] *= (float)(rs->phases / sum);
+	}
+}
+
+int8_t resampler_init(struct resampler_t *rs,
+	uint32_t in_rate, uint32_t out_rate, uint8_t channels) {
+	uint32_t div = gcd(in_rate, out_rate);
+	uint32_t taps = quality_levels[RESAMPLER_QUALITY].taps;
+	uint32_t phases = out_rate / div;
+	uint32_t decimation = in_rate / div;
+
+	/* a multiple of the fraction in lowest terms if it's too coarse */
+	if (phases < RESAMPLER_MIN_PHASES) {
+		div = (RESAMPLER_MIN_PHASES + phases - 1) / phases;
+		phases *= div;
+		decimation *= div;
+	}
+
+	if (phases > RESAMPLER_MAX_PHASES || decimation > 65535) {
+		fprintf(stderr, "Error: cannot resample %u Hz to %u Hz.\n",
+			in_rate, out_rate);
+		return -1;
+	}
+
+	rs->channels = channels;
+	rs->phases = phases;
+	rs->decimation = decimation;
+
+	/* keep the transition band the same width when decimating */
+	if (rs->decimation > rs->phases) {
+		taps = (taps * rs->decimation + rs->phases - 1)
+			/ rs->phases;
+	}
+	rs->taps = taps;
+
+	rs->coeffs = malloc(((size_t)rs->phases + 1) * rs->taps
+		* sizeof(float));
+
+	/* start with silence */
+	rs->buffer_len = rs->taps - 1 + RESAMPLER_BLOCK_FRAMES;
+	rs->buffer = malloc(channels * rs->buffer_len * sizeof(float));
+	memset(rs->buffer, 0, channels * rs->buffer_len * sizeof(float));
+	rs->fill = rs->next = rs->taps - 1;
+
+	/* take in the first input sample before the first output sample */
+	rs->phase = (uint64_t)rs->phases << 32;
+	resampler_set_ppm(rs, 0.0f);
+
+	design_filter(rs, quality_levels[RESAMPLER_QUALITY].beta);
+	init_simd();
+
+	return 0;
+}
+
+/*
+ * Move the samples still needed to the start of the buffer and
+ * fill the rest of it with new input
+ */
+static size_t fill_buffer(struct resampler_t *rs,
+	const float *in, size_t in_frames) {
+	uint16_t keep = rs->taps - 1;
+	float *buffer = rs->buffer;
+	size_t frames;
+
+	frames = rs->buffer_len - keep;
+	if (frames > in_frames) frames = in_frames;
+
+	for (uint8_t c = 0; c < rs->channels; c++) {
+		memmove(buffer, buffer + rs->fill - keep,
+			keep * sizeof(float));
+		for (size_t i = 0; i < frames; i++) {
+			buffer[keep + i] = in[i * rs->channels + c];
+		}
+		buffer += rs->buffer_len;
+	}
+
+	rs->fill = keep + frames;
+	rs->next = keep;
+
+	return frames;
+}
+
+/*
+ * Trim the ratio for an output clock that is off by ppm parts per
+ * million
+ *
+ * A positive value means the output clock runs fast, so more output
+ * samples are made from the same input
+ */
+void resampler_set_ppm(struct resampler_t *rs, float ppm) {
+	rs->step = (uint64_t)llround(rs->decimation * 4294967296.0
+		/ (1.0 + ppm * 1e-6));
+}
+
+/*
+ * How many more input frames it takes to generate a number of
+ * output frames
+ *
+ * Input that has been taken in but not used yet counts towards it
+ */
+size_t resampler_input_needed(struct resampler_t *rs, size_t out_frames) {
+	size_t needed, pending = rs->fill - rs->next;
+	uint64_t n = out_frames - 1;
+
+	if (out_frames == 0) return 0;
+
+	/*
+	 * A new input sample for every time the phase wraps around,
+	 * with the integer and fractional parts of the steps added up
+	 * separately so it can't overflow
+	 */
+	needed = (n * (rs->step >> 32) +
+		((n * (rs->step & 0xffffffff) + rs->phase) >> 32))
+		/ rs->phases;
+
+	return needed > pending ? needed - pending : 0;
+}
+
+/*
+ * Generate up to out_frames frames
+ *
+ * Stops early when the input runs out. Input that isn't taken
+ * (in_frames - frames_used) has to be passed in again on the next call.
+ */
+int8_t resample(struct resampler_t *rs,
+	const float *in, size_t in_frames, size_t *frames_used,
+	float *out, size_t out_frames, size_t *frames_generated) {
+	const uint64_t wrap = (uint64_t)rs->phases << 32;
+	const float *coeffs, *buffer;
+	size_t frames = 0, used = 0;
+	float sample, frac;
+
+	while (frames < out_frames) {
+		/* take in input samples up to the next output sample */
+		while (rs->phase >= wrap) {
+			if (rs->next == rs->fill) {
+				if (used == in_frames) goto done;
+
+				used += fill_buffer(rs, in + used * rs->channels,
+					in_frames - used);
+			}
+
+			rs->next++;
+			rs->phase -= wrap;
+		}
+
+		coeffs = rs->coeffs + (rs->phase >> 32) * rs->taps;
+		buffer = rs->buffer + rs->next - rs->taps;
+		frac = (uint32_t)rs->phase * (1.0f / 4294967296.0f);
+		for (uint8_t c = 0; c < rs->channels; c++) {
+			sample = simd_dot(coeffs, buffer, rs->taps);
+			if (frac != 0.0f) {
+				/* between two phases (the ratio is trimmed) */
+				sample += (simd_dot(coeffs + rs->taps, buffer,
+					rs->taps) - sample) * frac;
+			}
+			*out++ = sample;
+			buffer += rs->buffer_len;
+		}
+
+		frames++;
+		rs->phase += rs->step;
+	}
+
+done:
+	*frames_used = used;
+	*frames_generated = frames;
+
+	return 0;
+}
+
+void resampler_exit(struct resampler_t *rs) {
+	free(rs->coeffs);
+	free(rs->buffer);
+}
+#else
+/* libsamplerate converter for each quality */
+static const int converter_types[] = {
+	SRC_SINC_FASTEST,
+	SRC_SINC_MEDIUM_QUALITY,
+	SRC_SINC_BEST_QUALITY
+};
+
+int8_t resampler_init(struct resampler_t *rs,
+	uint32_t in_rate, uint32_t out_rate, uint8_t channels) {
 	int src_error;
 
-	*src_state = src_new(CONVERTER_TYPE, channels, &src_error);
+	rs->src_state = src_new(converter_types[RESAMPLER_QUALITY],
+		channels, &src_error);
 
-	if (*src_state == NULL) {
+	if (rs->src_state == NULL) {
 		fprintf(stderr, "Error: src_new failed: %s\n", src_strerror(src_error));
 		return -1;
 	}
 
+	rs->channels = channels;
+	rs->nominal_ratio = rs->ratio = (double)out_rate / in_rate;
+
 	return 0;
 }
 
-int8_t resample(SRC_STATE *src_state, SRC_DATA src_data, size_t *frames_generated) {
+void resampler_set_ppm(struct resampler_t *rs, float ppm) {
+	rs->ratio = rs->nominal_ratio * (1.0 + ppm * 1e-6);
+}
+
+/*
+ * libsamplerate keeps its own input history, so this is only how much
+ * input the ratio calls for
+ */
+size_t resampler_input_needed(struct resampler_t *rs, size_t out_frames) {
+	return (size_t)ceil(out_frames / rs->ratio);
+}
+
+int8_t resample(struct resampler_t *rs,
+	const float *in, size_t in_frames, size_t *frames_used,
+	float *out, size_t out_frames, size_t *frames_generated) {
+	SRC_DATA src_data;
 	int src_error;
 
-	src_error = src_process(src_state, &src_data);
+	memset(&src_data, 0, sizeof(SRC_DATA));
+	src_data.data_in = in;
+	src_data.input_frames = in_frames;
+	src_data.data_out = out;
+	src_data.output_frames = out_frames;
+	src_data.src_ratio = rs->ratio;
+
+	src_error = src_process(rs->src_state, &src_data);
 
 	if (src_error) {
 		fprintf(stderr, "Error: src_process failed: %s\n", src_strerror(src_error));
 		return -1;
 	}
 
+	*frames_used = src_data.input_frames_used;
 	*frames_generated = src_data.output_frames_gen;
 
 	return 0;
 }
 
-void resampler_exit(SRC_STATE *src_state) {
-	src_delete(src_state);
+void resampler_exit(struct resampler_t *rs) {
+	src_delete(rs->src_state);
 }
+#endif
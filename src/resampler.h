@@ -16,10 +16,86 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifndef BUILTIN_RESAMPLER
 #include <samplerate.h>
+#endif
 
-#define CONVERTER_TYPE SRC_SINC_MEDIUM_QUALITY
+/*
+ * Resampler quality
+ *
+ * 0: fast, 1: medium, 2: best
+ */
+#ifndef RESAMPLER_QUALITY
+#define RESAMPLER_QUALITY	1
+#endif
+
+/* largest interpolation factor the built-in resampler takes */
+#define RESAMPLER_MAX_PHASES	8192
+
+/*
+ * Fewest filter phases the built-in resampler uses, so that the ratio
+ * can be trimmed by interpolating between two neighbouring phases
+ */
+#define RESAMPLER_MIN_PHASES	64
+
+/* input frames the built-in resampler takes in at a time */
+#define RESAMPLER_BLOCK_FRAMES	256
+
+/* context for a resampler */
+typedef struct resampler_t {
+	uint8_t channels;
+#ifdef BUILTIN_RESAMPLER
+	/*
+	 * Rate change as a fraction: upsample by the number of phases,
+	 * then keep every decimation-th sample
+	 */
+	uint16_t phases;
+	uint16_t decimation;
+
+	/* filter length of each phase */
+	uint16_t taps;
+
+	/*
+	 * Filter coefficients, one phase after the other
+	 *
+	 * The taps of each phase are reversed so they line up with the
+	 * input buffer, which is in time order. There is one extra phase
+	 * at the end (the first one, one input sample later) to
+	 * interpolate towards.
+	 */
+	float *coeffs;
+
+	/*
+	 * Input of each channel: the last taps - 1 samples from before,
+	 * followed by a block of new ones
+	 */
+	float *buffer;
+	uint16_t buffer_len;
+	/* samples in the buffer */
+	uint16_t fill;
+	/* samples in the buffer that have been taken in */
+	uint16_t next;
+
+	/*
+	 * Position of the next output sample after the newest input
+	 * sample taken in, in 1/phases of an input sample (32.32 fixed
+	 * point), and how far it moves for each output sample
+	 */
+	uint64_t phase;
+	uint64_t step;
+#else
+	SRC_STATE *src_state;
+	double nominal_ratio;
+	double ratio;
+#endif
+} resampler_t;
 
-extern int8_t resampler_init(SRC_STATE **src_state, uint8_t channels);
-extern int8_t resample(SRC_STATE *src_state, SRC_DATA src_data, size_t *frames_generated);
-extern void resampler_exit(SRC_STATE *src_state);
+extern int8_t resampler_init(struct resampler_t *rs,
+	uint32_t in_rate, uint32_t out_rate, uint8_t channels);
+extern void resampler_set_ppm(struct resampler_t *rs, float ppm);
+extern size_t resampler_input_needed(struct resampler_t *rs,
+	size_t out_frames);
+extern int8_t resample(struct resampler_t *rs,
+	const float *in, size_t in_frames, size_t *frames_used,
+	float *out, size_t out_frames, size_t *frames_generated);
+extern void resampler_exit(struct resampler_t *rs);
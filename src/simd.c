@@ -0,0 +1,384 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2019 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86
+#elif defined(__aarch64__) || defined(__ARM_NEON) || \
+	(defined(__arm__) && defined(__ARM_PCS_VFP))
+#include <arm_neon.h>
+#define SIMD_ARM
+#ifndef __aarch64__
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+/*
+ * Plain C versions
+ *
+ * Always available
+ */
+static void mac_scalar(float *dst, const float *src, float gain,
+	size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		dst[i] += src[i] * gain;
+	}
+}
+
+static void modulate_scalar(float *dst, const float *carrier,
+	const float *env, float gain, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		dst[i] += carrier[i] * env[i] * gain;
+	}
+}
+
+static void clip_scalar(float *dst, const float *src, float gain,
+	size_t len) {
+	float sample;
+
+	for (size_t i = 0; i < len; i++) {
+		sample = fminf(+1.0f, src[i]);
+		sample = fmaxf(-1.0f, sample);
+		dst[i] = sample * gain;
+	}
+}
+
+static float dot_scalar(const float *a, const float *b, size_t len) {
+	float sum = 0.0f;
+
+	for (size_t i = 0; i < len; i++) {
+		sum += a[i] * b[i];
+	}
+
+	return sum;
+}
+
+#ifdef SIMD_X86
+__attribute__((target("sse2")))
+static void mac_sse2(float *dst, const float *src, float gain,
+	size_t len) {
+	__m128 g = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i),
+			_mm_mul_ps(_mm_loadu_ps(src + i), g)));
+	}
+
+	/* leftovers */
+	for (; i < len; i++) {
+		dst[i] += src[i] * gain;
+	}
+}
+
+__attribute__((target("sse2")))
+static void modulate_sse2(float *dst, const float *carrier,
+	const float *env, float gain, size_t len) {
+	__m128 g = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i),
+			_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(carrier + i),
+			_mm_loadu_ps(env + i)), g)));
+	}
+
+	/* leftovers */
+	for (; i < len; i++) {
+		dst[i] += carrier[i] * env[i] * gain;
+	}
+}
+
+__attribute__((target("sse2")))
+static void clip_sse2(float *dst, const float *src, float gain,
+	size_t len) {
+	__m128 g = _mm_set1_ps(gain);
+	__m128 hi = _mm_set1_ps(+1.0f);
+	__m128 lo = _mm_set1_ps(-1.0f);
+	__m128 x;
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		x = _mm_min_ps(hi, _mm_loadu_ps(src + i));
+		x = _mm_max_ps(lo, x);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(x, g));
+	}
+
+	/* leftovers */
+	clip_scalar(dst + i, src + i, gain, len - i);
+}
+
+__attribute__((target("sse2")))
+static float dot_sse2(const float *a, const float *b, size_t len) {
+	__m128 acc = _mm_setzero_ps();
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		acc = _mm_add_ps(acc, _mm_mul_ps(
+			_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+
+	/* add up the lanes */
+	acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+	acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+
+	/* leftovers */
+	return _mm_cvtss_f32(acc) + dot_scalar(a + i, b + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static void mac_avx2(float *dst, const float *src, float gain,
+	size_t len) {
+	__m256 g = _mm256_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i),
+			_mm256_mul_ps(_mm256_loadu_ps(src + i), g)));
+	}
+
+	/* leftovers */
+	for (; i < len; i++) {
+		dst[i] += src[i] * gain;
+	}
+}
+__attribute__((target("avx2")))
+static void modulate_avx2(float *dst, const float *carrier,
+	const float *env, float gain, size_t len) {
+	__m256 g = _mm256_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i),
+			_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(carrier + i),
+			_mm256_loadu_ps(env + i)), g)));
+	}
+
+	/* leftovers */
+	for (; i < len; i++) {
+		dst[i] += carrier[i] * env[i] * gain;
+	}
+}
+
+__attribute__((target("avx2")))
+static void clip_avx2(float *dst, const float *src, float gain,
+	size_t len) {
+	__m256 g = _mm256_set1_ps(gain);
+	__m256 hi = _mm256_set1_ps(+1.0f);
+	__m256 lo = _mm256_set1_ps(-1.0f);
+	__m256 x;
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		x = _mm256_min_ps(hi, _mm256_loadu_ps(src + i));
+		x = _mm256_max_ps(lo, x);
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(x, g));
+	}
+
+	/* leftovers */
+	clip_scalar(dst + i, src + i, gain, len - i);
+}
+
+__attribute__((target("avx2")))
+static float dot_avx2(const float *a, const float *b, size_t len) {
+	__m256 acc = _mm256_setzero_ps();
+	__m128 sum;
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(
+			_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	}
+
+	/* add up the lanes */
+	sum = _mm_add_ps(_mm256_castps256_ps128(acc),
+		_mm256_extractf128_ps(acc, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+
+	/* leftovers */
+	return _mm_cvtss_f32(sum) + dot_scalar(a + i, b + i, len - i);
+}
+#endif
+
+#ifdef SIMD_ARM
+#ifndef __aarch64__
+__attribute__((target("fpu=neon")))
+#endif
+static void mac_neon(float *dst, const float *src, float gain,
+	size_t len) {
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		vst1q_f32(dst + i, vmlaq_n_f32(
+			vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+	}
+
+	/* leftovers */
+	for (; i < len; i++) {
+		dst[i] += src[i] * gain;
+	}
+}
+
+#ifndef __aarch64__
+__attribute__((target("fpu=neon")))
+#endif
+static void modulate_neon(float *dst, const float *carrier,
+	const float *env, float gain, size_t len) {
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i),
+			vmulq_f32(vld1q_f32(carrier + i), vld1q_f32(env + i)),
+			gain));
+	}
+
+	/* leftovers */
+	for (; i < len; i++) {
+		dst[i] += carrier[i] * env[i] * gain;
+	}
+}
+
+#ifndef __aarch64__
+__attribute__((target("fpu=neon")))
+#endif
+static void clip_neon(float *dst, const float *src, float gain,
+	size_t len) {
+	float32x4_t x;
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		x = vminq_f32(vdupq_n_f32(+1.0f), vld1q_f32(src + i));
+		x = vmaxq_f32(vdupq_n_f32(-1.0f), x);
+		vst1q_f32(dst + i, vmulq_n_f32(x, gain));
+	}
+
+	/* leftovers */
+	clip_scalar(dst + i, src + i, gain, len - i);
+}
+
+#ifndef __aarch64__
+__attribute__((target("fpu=neon")))
+#endif
+static float dot_neon(const float *a, const float *b, size_t len) {
+	float32x4_t acc = vdupq_n_f32(0.0f);
+	float32x2_t sum;
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+	}
+
+	/* add up the lanes */
+	sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+	sum = vpadd_f32(sum, sum);
+
+	/* leftovers */
+	return vget_lane_f32(sum, 0) + dot_scalar(a + i, b + i, len - i);
+}
+#endif
+
+void (*simd_mac)(float *dst, const float *src, float gain,
+	size_t len) = mac_scalar;
+void (*simd_modulate)(float *dst, const float *carrier, const float *env,
+	float gain, size_t len) = modulate_scalar;
+void (*simd_clip)(float *dst, const float *src, float gain,
+	size_t len) = clip_scalar;
+float (*simd_dot)(const float *a, const float *b, size_t len) = dot_scalar;
+
+static const char *simd_name = "scalar";
+
+/*
+ * Pick the widest kernels the CPU can run
+ *
+ */
+static void pick_kernels() {
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		simd_mac = mac_avx2;
+		simd_modulate = modulate_avx2;
+		simd_clip = clip_avx2;
+		simd_dot = dot_avx2;
+		simd_name = "AVX2";
+	} else if (__builtin_cpu_supports("sse2")) {
+		simd_mac = mac_sse2;
+		simd_modulate = modulate_sse2;
+		simd_clip = clip_sse2;
+		simd_dot = dot_sse2;
+		simd_name = "SSE2";
+	}
+#endif
+
+#ifdef SIMD_ARM
+#ifndef __aarch64__
+	if (getauxval(AT_HWCAP) & HWCAP_NEON) {
+		simd_mac = mac_neon;
+		simd_modulate = modulate_neon;
+		simd_clip = clip_neon;
+		simd_dot = dot_neon;
+		simd_name = "NEON";
+	}
+#else
+	/* NEON is mandatory on AArch64 */
+	simd_mac = mac_neon;
+	simd_modulate = modulate_neon;
+	simd_clip = clip_neon;
+	simd_dot = dot_neon;
+	simd_name = "NEON";
+#endif
+#endif
+}
+
+void init_simd() {
+	static bool done;
+
+	if (done) return;
+	done = true;
+
+	pick_kernels();
+}
+
+/*
+ * Switch to the plain C kernels or back to the widest ones (so the
+ * benchmark can compare them)
+ *
+ */
+void set_simd_scalar(bool scalar) {
+	init_simd();
+
+	if (!scalar) {
+		pick_kernels();
+		return;
+	}
+
+	simd_mac = mac_scalar;
+	simd_modulate = modulate_scalar;
+	simd_clip = clip_scalar;
+	simd_dot = dot_scalar;
+	simd_name = "scalar";
+}
+
+const char *get_simd_name() {
+	return simd_name;
+}
@@ -0,0 +1,37 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2019 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Vector kernels
+ *
+ * These are selected at run-time based on what the CPU supports
+ */
+extern void (*simd_mac)(float *dst, const float *src, float gain,
+	size_t len);
+/* dst += carrier * env * gain */
+extern void (*simd_modulate)(float *dst, const float *carrier,
+	const float *env, float gain, size_t len);
+/* dst = src clipped to +/- 1 * gain */
+extern void (*simd_clip)(float *dst, const float *src, float gain,
+	size_t len);
+/* sum of a[i] * b[i] */
+extern float (*simd_dot)(const float *a, const float *b, size_t len);
+
+extern void init_simd();
+extern void set_simd_scalar(bool scalar);
+extern const char *get_simd_name();
@@ -0,0 +1,143 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* for popen */
+#define _POSIX_C_SOURCE 200809L
+
+#include "common.h"
+#include "rds.h"
+#include "fm_mpx.h"
+#ifndef FIXED_POINT
+#include "limiter.h"
+#endif
+
+/*
+ * Fixed point test
+ *
+ * This file is built twice at 228 kHz, once for each signal path. The
+ * float build (test_fixed_ref) writes its MPX signal to stdout and the
+ * fixed point build (test_fixed) runs it and compares the two.
+ *
+ * The fixed point path has Q15 tables and levels and mixes in Q30, so
+ * against the float signal scaled to 16 bits it is only off by the
+ * rounding of those: no sample more than TEST_MAX_LSB away and an SNR
+ * of at least TEST_MIN_SNR dB over the whole run.
+ *
+ */
+
+#define TEST_MAX_LSB	1
+#define TEST_MIN_SNR	75.0
+
+/* about 2 seconds, so every RDS group type has gone out */
+#define TEST_BLOCKS	450
+
+static void init_generator() {
+	struct rds_params_t rds_params = {
+		.ps = "MiniRDS",
+		.rt = "MiniRDS: Software RDS encoder",
+		.pi = 0x1000
+	};
+
+	fm_mpx_init(MPX_SAMPLE_RATE);
+	set_output_volume(100.0f);
+	init_rds_encoder(rds_params);
+
+	/* no CT, which would depend on when each build is run */
+	set_rds_ct(0);
+}
+
+#ifdef FIXED_POINT
+int main() {
+	sample_t fixed[NUM_MPX_FRAMES_IN];
+	float ref[NUM_MPX_FRAMES_IN];
+	double signal = 0.0, noise = 0.0, err, snr;
+	int32_t max_err = 0;
+	FILE *f;
+	int status;
+
+	f = popen("./test_fixed_ref", "r");
+	if (f == NULL) {
+		fprintf(stderr, "Error: could not run the float build.\n");
+		return 1;
+	}
+
+	init_generator();
+
+	for (uint16_t n = 0; n < TEST_BLOCKS; n++) {
+		if (fread(ref, sizeof(float), NUM_MPX_FRAMES_IN, f)
+			!= NUM_MPX_FRAMES_IN) {
+			fprintf(stderr, "Error: short read from the float build.\n");
+			pclose(f);
+			return 1;
+		}
+		fm_rds_get_frames(fixed, NUM_MPX_FRAMES_IN);
+
+		for (uint16_t i = 0; i < NUM_MPX_FRAMES_IN; i++) {
+			ref[i] *= Q15_ONE;
+			err = fixed[i] - ref[i];
+			if (abs((int32_t)lround(err)) > max_err)
+				max_err = abs((int32_t)lround(err));
+			signal += ref[i] * ref[i];
+			noise += err * err;
+		}
+	}
+
+	status = pclose(f);
+	fm_mpx_exit();
+	exit_rds_encoder();
+
+	snr = 10.0 * log10(signal / (noise + 1e-30));
+	printf("test_fixed: max error %d LSB, SNR %.1f dB\n", max_err, snr);
+
+	if (status != 0) {
+		fprintf(stderr, "FAIL: the float build failed\n");
+		return 1;
+	}
+	if (max_err > TEST_MAX_LSB || snr < TEST_MIN_SNR) {
+		fprintf(stderr, "FAIL: over %d LSB or under %.0f dB\n",
+			TEST_MAX_LSB, TEST_MIN_SNR);
+		return 1;
+	}
+
+	printf("test_fixed: passed\n");
+	return 0;
+}
+#else
+int main() {
+	float buf[NUM_MPX_FRAMES_IN];
+	/* the limiter look-ahead delays the float signal */
+	uint16_t delay = lroundf(MPX_SAMPLE_RATE * LIMITER_LOOKAHEAD_MS
+		/ 1000.0f) - 1;
+
+	init_generator();
+
+	fm_rds_get_frames(buf, NUM_MPX_FRAMES_IN);
+	fwrite(buf + delay, sizeof(float), NUM_MPX_FRAMES_IN - delay, stdout);
+	for (uint16_t n = 1; n < TEST_BLOCKS; n++) {
+		fm_rds_get_frames(buf, NUM_MPX_FRAMES_IN);
+		fwrite(buf, sizeof(float), NUM_MPX_FRAMES_IN, stdout);
+	}
+	/* the delayed end of the last block */
+	fm_rds_get_frames(buf, NUM_MPX_FRAMES_IN);
+	fwrite(buf, sizeof(float), delay, stdout);
+
+	fm_mpx_exit();
+	exit_rds_encoder();
+	return 0;
+}
+#endif
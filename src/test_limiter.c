@@ -0,0 +1,123 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "limiter.h"
+
+/*
+ * Limiter test
+ *
+ * A burst over the ceiling has to be limited, and once it is over and
+ * the gain is released the limiter has to be back at exactly unity:
+ * no gain reduction in the meters and the input delayed untouched.
+ *
+ */
+
+#define TEST_RATE	192000
+#define TEST_FRAMES	1024
+
+static uint32_t failures;
+
+static void check(bool ok, const char *what, float release_ms) {
+	if (ok) return;
+	fprintf(stderr, "FAIL (%.0f ms release): %s\n", release_ms, what);
+	failures++;
+}
+
+/* a 1 kHz tone of some level, carried on from block to block */
+static void make_tone(float *buf, float level, uint64_t *pos) {
+	for (size_t i = 0; i < TEST_FRAMES; i++) {
+		buf[i] = level * sinf(M_2PI * 1000.0 * (*pos)++ / TEST_RATE);
+	}
+}
+
+static float get_peak(const float *buf, float peak) {
+	for (size_t i = 0; i < TEST_FRAMES; i++) {
+		if (fabsf(buf[i]) > peak) peak = fabsf(buf[i]);
+	}
+	return peak;
+}
+
+static void test_release(float release_ms) {
+	struct limiter_t lim;
+	struct limiter_meters_t meters;
+	float in[TEST_FRAMES], buf[TEST_FRAMES];
+	float *history;
+	uint16_t delay;
+	uint64_t pos = 0;
+	float peak = 0.0f;
+	bool same;
+
+	limiter_init(&lim, TEST_RATE, TEST_FRAMES);
+	limiter_set(&lim, 1.0f, release_ms);
+	delay = lim.lookahead - 1;
+	history = malloc((delay + TEST_FRAMES) * sizeof(float));
+
+	/* the burst, with the quiet tone on both sides */
+	make_tone(buf, 0.5f, &pos);
+	limiter_process(&lim, buf, TEST_FRAMES);
+	make_tone(buf, 2.0f, &pos);
+	limiter_process(&lim, buf, TEST_FRAMES);
+	peak = get_peak(buf, peak);
+
+	limiter_get_meters(&lim, &meters);
+	check(meters.limited > 0, "the burst was not limited", release_ms);
+	check(meters.min_gain < 0.6f, "no gain reduction", release_ms);
+
+	/* ten release times is plenty */
+	for (uint32_t n = 0; n < release_ms * 10 * TEST_RATE / 1000
+		/ TEST_FRAMES + 1; n++) {
+		make_tone(buf, 0.5f, &pos);
+		limiter_process(&lim, buf, TEST_FRAMES);
+		peak = get_peak(buf, peak);
+	}
+	check(peak <= 1.0f + 1e-6f, "the output went over the ceiling",
+		release_ms);
+	check(lim.gain == 1.0f, "the gain did not get back to unity",
+		release_ms);
+
+	/* the next blocks must come out exactly as they went in */
+	limiter_get_meters(&lim, &meters);
+	memcpy(history, lim.delay, delay * sizeof(float));
+	make_tone(in, 0.5f, &pos);
+	memcpy(history + delay, in, TEST_FRAMES * sizeof(float));
+	memcpy(buf, in, TEST_FRAMES * sizeof(float));
+	limiter_process(&lim, buf, TEST_FRAMES);
+	same = memcmp(buf, history, TEST_FRAMES * sizeof(float)) == 0;
+
+	limiter_get_meters(&lim, &meters);
+	check(meters.min_gain == 1.0f, "gain reduction left in the meters",
+		release_ms);
+	check(meters.limited == 0, "samples limited after the burst",
+		release_ms);
+	check(same, "the output is not the delayed input", release_ms);
+
+	limiter_exit(&lim);
+	free(history);
+}
+
+int main() {
+	test_release(LIMITER_RELEASE_MS);
+	test_release(1.0f);
+	test_release(LIMITER_MAX_RELEASE_MS);
+
+	if (failures) return 1;
+
+	printf("test_limiter: passed\n");
+	return 0;
+}
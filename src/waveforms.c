@@ -1,7 +1,80 @@
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+#include "rds.h"
+#include "modulator.h"
+#include "waveforms.h"
+
+/*
+ * RDS data-shaping filter
+ *
+ * The spectrum of each data pulse is shaped by cos(pi * f * td / 4)
+ * for f <= 2 / td (td = 1 / 1187.5 s). Its impulse response, with time
+ * x in bit periods, is
+ *
+ *	cos(4 * pi * x) / (1 - 64 * x^2)
+ *
+ * which is scaled here to the levels of the original PiFmRds table.
+ */
+static double shaping_filter(double x) {
+	double d = 1.0 - 64.0 * x * x;
+
+	/* cos(4 * pi * x) is also 0 at +/- 1/8 */
+	if (fabs(d) < 1e-9) return 0.4;
 
-/* This file was automatically generated by "generate_waveforms.py".
-   (C) 2014 Christophe Jacquet.
-   Released under the GNU GPL v3 license.
+	return (8.0 / (5.0 * M_PI)) * cos(2.0 * M_2PI * x) / d;
+}
+
+/*
+ * Create the elementary biphase symbol
+ *
+ * This is the data-shaping filter applied to a positive impulse a
+ * quarter bit before the center and a negative one a quarter bit
+ * after it. The pulse is truncated to span bit periods.
+ *
+ * The returned table is cache aligned and should be freed when no
+ * longer needed.
  */
+const float *create_biphase_pulse(uint32_t sample_rate,
+	uint8_t span, uint8_t window) {
+	float *pulse;
+	double samples_per_bit = sample_rate / RDS_BIT_RATE;
+	uint16_t len = (uint16_t)lround(span * samples_per_bit);
+	double x;
+
+	pulse = alloc_aligned(len * sizeof(float));
+
+	for (uint16_t i = 0; i < len; i++) {
+		/* time from the center of the pulse in bit periods */
+		x = (i - len / 2.0) / samples_per_bit;
+
+		pulse[i] = (float)(shaping_filter(x + 0.25)
+			- shaping_filter(x - 0.25));
+
+		switch (window) {
+		case PULSE_WINDOW_HANN:
+			pulse[i] *= (float)(0.5 + 0.5 * cos(M_2PI * x / span));
+			break;
+		default:
+			break;
+		}
+	}
 
-float waveform_biphase[1120] = {0.000187998621033, 0.000188435409401, 0.000187705188745, 0.000185799757689, 0.000182718086847, 0.000178466403438, 0.000173058232277, 0.000166514392427, 0.000158862949033, 0.000150139120151, 0.000140385138662, 0.000129650069598, 0.000117989583533, 0.000105465686927, 9.21464106041e-05, 7.81054578096e-05, 6.34218135435e-05, 4.81793171422e-05, 3.24662003054e-05, 1.63745930139e-05, -5.59926582713e-18, -1.65592493568e-05, -3.32025746409e-05, -4.98277382766e-05, -6.63314562638e-05, -8.26100222307e-05, -9.85599411374e-05, -0.000114078568866, -0.000129064753854, -0.000143419476872, -0.000157046485015, -0.000169852915966, -0.000181749908607, -0.000192653196087, -0.000202483677526, -0.000211167964614, -0.000218638899478, -0.000224836040328, -0.000229706111527, -0.000233203414943, -0.000235290199616, -0.000235936986992, -0.000235122849234, -0.000232835638346, -0.000229072164162, -0.000223838319489, -0.000217149151043, -0.000209028875099, -0.000199510837108, -0.00018863741487, -0.000176459865203, -0.000163038114344, -0.000148440492734, -0.000132743415113, -0.000116031007252, -9.83946809495e-05, -7.99326592792e-05, -6.07494543859e-05, -4.09553004503e-05, -2.06655447462e-05, 6.72575950178e-19, 2.09177384594e-05, 4.19610070206e-05, 6.30008156011e-05, 8.3906612757e-05, 0.000104547069707, 0.000124790878716, 0.000144507561146, 0.000163568280364, 0.000181846654599, 0.000199219564799, 0.000215567952505, 0.00023077760273, 0.000244739906911, 0.000257352601014, 0.000268520473994, 0.000278156041926, 0.000286180183249, 0.000292522730793, 0.000297123016414, 0.000299930364345, 0.000300904529591, 0.000300016078023, 0.000297246705103, 0.000292589490539, 0.000286049086491, 0.000277641837343, 0.000267395829448, 0.000255350869641, 0.000241558391745, 0.000226081290712, 0.000208993684496, 0.00019038060416, 0.000170337613192, 0.000148970357429, 0.000126394047439, 0.000102732875622, 7.81193707498e-05, 5.26936930394e-05, 2.66028732948e-05, -2.05785081829e-18, -2.69566413611e-05, -5.4104472151e-05, -8.12775626578e-05, -0.000108307607181, -0.000135024926622, -0.000161259492853, -0.000186841968914, -0.000211604758918, -0.00023538306142, -0.000258015919873, -0.000279347263764, -0.000299226933944, -0.000317511685736, -0.000334066163396, -0.000348763839633, -0.000361487913991, -0.000372132164077, -0.000380601743823, -0.000386813923198, -0.000390698764081, -0.000392199727315, -0.000391274206292, -0.000387893982838, -0.000382045601539, -0.000373730659108, -0.000362966005862, -0.000349783856863, -0.000334231810783, -0.000316372775096, -0.000296284796741, -0.000274060797945, -0.000249808217499, -0.000223648558302, -0.000195716842628, -0.00016616097708, -0.000135141029831, -0.000102828423276, -6.94050457864e-05, -3.50622867989e-05, -3.93902003755e-18, 3.55746001483e-05, 7.14481028032e-05, 0.000107402119877, 0.000143214553315, 0.000178660903527, 0.000213515611646, 0.000247553427962, 0.00028055079863, 0.000312287262509, 0.000342546849813, 0.000371119474143, 0.000397802309351, 0.00042240114268, 0.000444731695634, 0.000464620904093, 0.000481908149324, 0.000496446431683, 0.000508103479072, 0.000516762782428, 0.000522324550911, 0.000524706579771, 0.000523845024343, 0.000519695074047, 0.000512231520806, 0.000501449216827, 0.000487363417292, 0.000470010004115, 0.000449445587592, 0.000425747483445, 0.000399013563475, 0.000369361978772, 0.000336930755172, 0.000301877261419, 0.000264377551266, 0.000224625581504, 0.000182832308702, 0.000139224668214, 9.40444397454e-05, 4.75470045438e-05, 2.67464941501e-18, -4.83181218569e-05, -9.71196247998e-05, -0.000146109099966, -0.000194985150119, -0.000243442137623, -0.0002911719866, -0.000337866029302, -0.000383216886255, -0.000426920369408, -0.000468677397187, -0.000508195910102, -0.000545192775382, -0.000579395668975, -0.000610544923215, -0.000638395328454, -0.000662717877053, -0.000683301438277, -0.000699954352854, -0.000712505936276, -0.000720807880257, -0.00072473554221, -0.000724189113111, -0.000719094654655, -0.000709404997283, -0.000695100491294, -0.000676189604039, -0.00065270935699, -0.00062472559729, -0.000592333099347, -0.000555655492903, -0.000514845015038, -0.000470082084535, -0.000421574698084, -0.000369557648839, -0.000314291568925, -0.000256061798543, -0.00019517708541, -0.000131968119358, -6.67859079431e-05, 6.99424202006e-18, 6.80034349294e-05, 0.000136823662345, 0.000206047563827, 0.000275251932546, 0.000344005871564, 0.000411873282423, 0.000478415430762, 0.000543193575014, 0.000605771643609, 0.000665718945553, 0.0007226128988, 0.000776041760416, 0.000825607342286, 0.000870927695842, 0.000911639749213, 0.000947401880183, 0.000977896408367, 0.00100283199025, 0.00102194590096, 0.00103500618704, 0.00104181367492, 0.00104220382044, 0.00103604838531, 0.00102325692726, 0.0010037780914, 0.000977600691386, 0.000944754569738, 0.000905311228108, 0.000859384219154, 0.00080712929312, 0.000748744293455, 0.000684468797171, 0.000614583497076, 0.000539409324465, 0.000459306312352, 0.000374672200841, 0.000285940787799, 0.000193580029511, 9.80898975997e-05, -2.81612817926e-18, -0.000100133024654, -0.000201728328387, -0.000304183878642, -0.000406879672686, -0.000509181126504, -0.000610442621715, -0.000710011192782, -0.000807230335614, -0.000901443917571, -0.00099200016788, -0.00107825572658, -0.0011595797293, -0.0012353579046, -0.00130499665984, -0.00136792713138, -0.00142360917446, -0.00147153526783, -0.00151123430862, -0.00154227527245, -0.0015642707145, -0.00157688008759, -0.00157981285366, -0.00157283136592, -0.00155575349982, -0.00152845501183, -0.0014908716062, -0.0014430006912, -0.00138490280758, -0.00131670271373, -0.00123859011341, -0.00115082001382, -0.00105371270374, -0.00094765334301, -0.000833091157316, -0.000710538233702, -0.000580567914926, -0.000443812792769, -0.000300962302783, -0.000152759925319, -1.08075391688e-17, 0.000156475836799, 0.000315782579539, 0.000476996131903, 0.000639157919366, 0.000801279817067, 0.000962349371873, 0.00112133529534, 0.00127719320224, 0.0014288715673, 0.00157531787095, 0.00171548490315, 0.00184833719262, 0.00197285752753, 0.0020880535322, 0.00219296426326, 0.00228666678787, 0.00236828270556, 0.00243698457484, 0.00249200220532, 0.00253262877585, 0.00255822673909, 0.00256823347344, 0.0025621666435, 0.00253962923092, 0.00250031419857, 0.00244400875188, 0.00237059816278, 0.00228006912302, 0.00217251259565, 0.00204812613524, 0.00190721564993, 0.00175019658041, 0.00157759447394, 0.00139004493402, 0.00118829292943, 0.000973191449411, 0.000745699494981, 0.000506879399966, 0.000257893478548, 4.28986546964e-18, -0.000265451505175, -0.000537025599647, -0.000813206942365, -0.00109240692469, -0.00137297091995, -0.00165318612313, -0.00193128995337, -0.00220547898833, -0.00247391839576, -0.00273475182397, -0.0029861117094, -0.00322612995609, -0.00345294893875, -0.00366473277802, -0.0038596788335, -0.00403602935783, -0.00419208325236, -0.00432620786298, -0.0044368507526, -0.00452255138545, -0.00458195265653, -0.00461381219909, -0.00461701340185, -0.00459057606746, -0.00453366664374, -0.00444560795931, -0.0043258883961, -0.00417417043211, -0.0039902984891, -0.0037743060218, -0.00352642178717, -0.0032470752347, -0.00293690096159, -0.00259674217973, -0.00222765314504, -0.00183090050333, -0.00140796351109, -0.00096053309422, -0.000490509712144, 2.80760318181e-17, 0.000508687833159, 0.00103304986677, 0.00157039360263, 0.00211784637506, 0.0026723650363, 0.00323074690959, 0.00378964199625, 0.00434556641635, 0.00489491705639, 0.00543398739049, 0.00595898443533, 0.00646604679233, 0.00695126372433, 0.00741069520729, 0.00784039289175, 0.00823642190218, 0.00859488339689, 0.0089119378051, 0.00918382865254, 0.00940690688174, 0.00957765556817, 0.00969271492907, 0.00974890751747, 0.00974326349013, 0.00967304583503, 0.00953577544069, 0.0093292558875, 0.0090515978392, 0.00870124291095, 0.0082769868899, 0.00777800218333, 0.00720385936983, 0.00655454772969, 0.0058304946316, 0.00503258365518, 0.00416217133054, 0.0032211023798, 0.00221172334828, 0.001136894518, -2.18363298506e-17, -0.00119504409203, -0.00244378347914, -0.00374122165118, -0.00508181797652, -0.00645948805916, -0.00786760640705, -0.0092990114674, -0.0107460130761, -0.0122004023592, -0.0136534641156, -0.0150959916992, -0.0165183044107, -0.0179102673973, -0.0192613140492, -0.02056047087, -0.0217963847899, -0.0229573528769, -0.024031354392, -0.0250060851235, -0.0258689939248, -0.0266073213689, -0.0272081404229, -0.0276583990346, -0.0279449645156, -0.0280546695919, -0.0279743599869, -0.0276909433908, -0.0271914396627, -0.026463032102, -0.0254931196209, -0.0242693696396, -0.0227797715208, -0.0210126903553, -0.0189569209017, -0.0166017414832, -0.0139369676371, -0.0109530053113, -0.00764090339839, -0.0039924053987, -1.17010830861e-17, 0.00434302963605, 0.009042558091, 0.0141035716181, 0.0195301239882, 0.0253252944542, 0.0314911480331, 0.0380286982977, 0.0449378728637, 0.0522174817547, 0.0598651888146, 0.067877486333, 0.0762496730385, 0.0849758356043, 0.0940488338006, 0.103460289418, 0.11320057907, 0.123258830982, 0.133622925837, 0.144279501769, 0.155213963549, 0.16641049601, 0.177852081747, 0.189520523099, 0.201396468406, 0.213459442547, 0.225687881699, 0.238059172282, 0.250549694035, 0.263134867117, 0.275789203172, 0.288486360211, 0.30119920122, 0.313899856323, 0.326559788363, 0.339149861728, 0.351640414229, 0.36400133185, 0.376202126144, 0.388212014065, 0.4, 0.411534959756, 0.422785726255, 0.433721176669, 0.444310320731, 0.454522389941, 0.464326927382, 0.473693877874, 0.482593678145, 0.490997346756, 0.498876573455, 0.506203807678, 0.512952345895, 0.519096417498, 0.524611268941, 0.529473245843, 0.533659872759, 0.537149930339, 0.539923529601, 0.541962183058, 0.54324887242, 0.54376811264, 0.543506012053, 0.542450328394, 0.540590520458, 0.537917795219, 0.534425150218, 0.530107411034, 0.524961263692, 0.518985281867, 0.512179948747, 0.504547673468, 0.496092802009, 0.486821622492, 0.476742364829, 0.465865194681, 0.454202201712, 0.441767382155, 0.428576615693, 0.414647636713, 0.4, 0.384655040929, 0.368635830281, 0.351967123784, 0.334675306525, 0.316788332383, 0.298335658656, 0.279348176072, 0.259858134386, 0.239899063781, 0.21950569232, 0.198713859677, 0.177560427425, 0.156083186152, 0.13432075968, 0.112312506694, 0.0900984200763, 0.0677190242655, 0.0452152709518, 0.022628433439, 0.0, -0.022628433439, -0.0452152709518, -0.0677190242655, -0.0900984200763, -0.112312506694, -0.13432075968, -0.156083186152, -0.177560427425, -0.198713859677, -0.21950569232, -0.239899063781, -0.259858134386, -0.279348176072, -0.298335658656, -0.316788332383, -0.334675306525, -0.351967123784, -0.368635830281, -0.384655040929, -0.4, -0.414647636713, -0.428576615693, -0.441767382155, -0.454202201712, -0.465865194681, -0.476742364829, -0.486821622492, -0.496092802009, -0.504547673468, -0.512179948747, -0.518985281867, -0.524961263692, -0.530107411034, -0.534425150218, -0.537917795219, -0.540590520458, -0.542450328394, -0.543506012053, -0.54376811264, -0.54324887242, -0.541962183058, -0.539923529601, -0.537149930339, -0.533659872759, -0.529473245843, -0.524611268941, -0.519096417498, -0.512952345895, -0.506203807678, -0.498876573455, -0.490997346756, -0.482593678145, -0.473693877874, -0.464326927382, -0.454522389941, -0.444310320731, -0.433721176669, -0.422785726255, -0.411534959756, -0.4, -0.388212014065, -0.376202126144, -0.36400133185, -0.351640414229, -0.339149861728, -0.326559788363, -0.313899856323, -0.30119920122, -0.288486360211, -0.275789203172, -0.263134867117, -0.250549694035, -0.238059172282, -0.225687881699, -0.213459442547, -0.201396468406, -0.189520523099, -0.177852081747, -0.16641049601, -0.155213963549, -0.144279501769, -0.133622925837, -0.123258830982, -0.11320057907, -0.103460289418, -0.0940488338006, -0.0849758356043, -0.0762496730385, -0.067877486333, -0.0598651888146, -0.0522174817547, -0.0449378728637, -0.0380286982977, -0.0314911480331, -0.0253252944542, -0.0195301239882, -0.0141035716181, -0.009042558091, -0.00434302963605, 1.17010830861e-17, 0.0039924053987, 0.00764090339839, 0.0109530053113, 0.0139369676371, 0.0166017414832, 0.0189569209017, 0.0210126903553, 0.0227797715208, 0.0242693696396, 0.0254931196209, 0.026463032102, 0.0271914396627, 0.0276909433908, 0.0279743599869, 0.0280546695919, 0.0279449645156, 0.0276583990346, 0.0272081404229, 0.0266073213689, 0.0258689939248, 0.0250060851235, 0.024031354392, 0.0229573528769, 0.0217963847899, 0.02056047087, 0.0192613140492, 0.0179102673973, 0.0165183044107, 0.0150959916992, 0.0136534641156, 0.0122004023592, 0.0107460130761, 0.0092990114674, 0.00786760640705, 0.00645948805916, 0.00508181797652, 0.00374122165118, 0.00244378347914, 0.00119504409203, 2.18363298506e-17, -0.001136894518, -0.00221172334828, -0.0032211023798, -0.00416217133054, -0.00503258365518, -0.0058304946316, -0.00655454772969, -0.00720385936983, -0.00777800218333, -0.0082769868899, -0.00870124291095, -0.0090515978392, -0.0093292558875, -0.00953577544069, -0.00967304583503, -0.00974326349013, -0.00974890751747, -0.00969271492907, -0.00957765556817, -0.00940690688174, -0.00918382865254, -0.0089119378051, -0.00859488339689, -0.00823642190218, -0.00784039289175, -0.00741069520729, -0.00695126372433, -0.00646604679233, -0.00595898443533, -0.00543398739049, -0.00489491705639, -0.00434556641635, -0.00378964199625, -0.00323074690959, -0.0026723650363, -0.00211784637506, -0.00157039360263, -0.00103304986677, -0.000508687833159, -2.80760318181e-17, 0.000490509712144, 0.00096053309422, 0.00140796351109, 0.00183090050333, 0.00222765314504, 0.00259674217973, 0.00293690096159, 0.0032470752347, 0.00352642178717, 0.0037743060218, 0.0039902984891, 0.00417417043211, 0.0043258883961, 0.00444560795931, 0.00453366664374, 0.00459057606746, 0.00461701340185, 0.00461381219909, 0.00458195265653, 0.00452255138545, 0.0044368507526, 0.00432620786298, 0.00419208325236, 0.00403602935783, 0.0038596788335, 0.00366473277802, 0.00345294893875, 0.00322612995609, 0.0029861117094, 0.00273475182397, 0.00247391839576, 0.00220547898833, 0.00193128995337, 0.00165318612313, 0.00137297091995, 0.00109240692469, 0.000813206942365, 0.000537025599647, 0.000265451505175, -4.28986546964e-18, -0.000257893478548, -0.000506879399966, -0.000745699494981, -0.000973191449411, -0.00118829292943, -0.00139004493402, -0.00157759447394, -0.00175019658041, -0.00190721564993, -0.00204812613524, -0.00217251259565, -0.00228006912302, -0.00237059816278, -0.00244400875188, -0.00250031419857, -0.00253962923092, -0.0025621666435, -0.00256823347344, -0.00255822673909, -0.00253262877585, -0.00249200220532, -0.00243698457484, -0.00236828270556, -0.00228666678787, -0.00219296426326, -0.0020880535322, -0.00197285752753, -0.00184833719262, -0.00171548490315, -0.00157531787095, -0.0014288715673, -0.00127719320224, -0.00112133529534, -0.000962349371873, -0.000801279817067, -0.000639157919366, -0.000476996131903, -0.000315782579539, -0.000156475836799, 1.08075391688e-17, 0.000152759925319, 0.000300962302783, 0.000443812792769, 0.000580567914926, 0.000710538233702, 0.000833091157316, 0.00094765334301, 0.00105371270374, 0.00115082001382, 0.00123859011341, 0.00131670271373, 0.00138490280758, 0.0014430006912, 0.0014908716062, 0.00152845501183, 0.00155575349982, 0.00157283136592, 0.00157981285366, 0.00157688008759, 0.0015642707145, 0.00154227527245, 0.00151123430862, 0.00147153526783, 0.00142360917446, 0.00136792713138, 0.00130499665984, 0.0012353579046, 0.0011595797293, 0.00107825572658, 0.00099200016788, 0.000901443917571, 0.000807230335614, 0.000710011192782, 0.000610442621715, 0.000509181126504, 0.000406879672686, 0.000304183878642, 0.000201728328387, 0.000100133024654, 2.81612817926e-18, -9.80898975997e-05, -0.000193580029511, -0.000285940787799, -0.000374672200841, -0.000459306312352, -0.000539409324465, -0.000614583497076, -0.000684468797171, -0.000748744293455, -0.00080712929312, -0.000859384219154, -0.000905311228108, -0.000944754569738, -0.000977600691386, -0.0010037780914, -0.00102325692726, -0.00103604838531, -0.00104220382044, -0.00104181367492, -0.00103500618704, -0.00102194590096, -0.00100283199025, -0.000977896408367, -0.000947401880183, -0.000911639749213, -0.000870927695842, -0.000825607342286, -0.000776041760416, -0.0007226128988, -0.000665718945553, -0.000605771643609, -0.000543193575014, -0.000478415430762, -0.000411873282423, -0.000344005871564, -0.000275251932546, -0.000206047563827, -0.000136823662345, -6.80034349294e-05, -6.99424202006e-18, 6.67859079431e-05, 0.000131968119358, 0.00019517708541, 0.000256061798543, 0.000314291568925, 0.000369557648839, 0.000421574698084, 0.000470082084535, 0.000514845015038, 0.000555655492903, 0.000592333099347, 0.00062472559729, 0.00065270935699, 0.000676189604039, 0.000695100491294, 0.000709404997283, 0.000719094654655, 0.000724189113111, 0.00072473554221, 0.000720807880257, 0.000712505936276, 0.000699954352854, 0.000683301438277, 0.000662717877053, 0.000638395328454, 0.000610544923215, 0.000579395668975, 0.000545192775382, 0.000508195910102, 0.000468677397187, 0.000426920369408, 0.000383216886255, 0.000337866029302, 0.0002911719866, 0.000243442137623, 0.000194985150119, 0.000146109099966, 9.71196247998e-05, 4.83181218569e-05, -2.67464941501e-18, -4.75470045438e-05, -9.40444397454e-05, -0.000139224668214, -0.000182832308702, -0.000224625581504, -0.000264377551266, -0.000301877261419, -0.000336930755172, -0.000369361978772, -0.000399013563475, -0.000425747483445, -0.000449445587592, -0.000470010004115, -0.000487363417292, -0.000501449216827, -0.000512231520806, -0.000519695074047, -0.000523845024343, -0.000524706579771, -0.000522324550911, -0.000516762782428, -0.000508103479072, -0.000496446431683, -0.000481908149324, -0.000464620904093, -0.000444731695634, -0.00042240114268, -0.000397802309351, -0.000371119474143, -0.000342546849813, -0.000312287262509, -0.00028055079863, -0.000247553427962, -0.000213515611646, -0.000178660903527, -0.000143214553315, -0.000107402119877, -7.14481028032e-05, -3.55746001483e-05, 3.93902003755e-18, 3.50622867989e-05, 6.94050457864e-05, 0.000102828423276, 0.000135141029831, 0.00016616097708, 0.000195716842628, 0.000223648558302, 0.000249808217499, 0.000274060797945, 0.000296284796741, 0.000316372775096, 0.000334231810783, 0.000349783856863, 0.000362966005862, 0.000373730659108, 0.000382045601539, 0.000387893982838, 0.000391274206292, 0.000392199727315, 0.000390698764081, 0.000386813923198, 0.000380601743823, 0.000372132164077, 0.000361487913991, 0.000348763839633, 0.000334066163396, 0.000317511685736, 0.000299226933944, 0.000279347263764, 0.000258015919873, 0.00023538306142, 0.000211604758918, 0.000186841968914, 0.000161259492853, 0.000135024926622, 0.000108307607181, 8.12775626578e-05, 5.4104472151e-05, 2.69566413611e-05, 2.05785081829e-18, -2.66028732948e-05, -5.26936930394e-05, -7.81193707498e-05, -0.000102732875622, -0.000126394047439, -0.000148970357429, -0.000170337613192, -0.00019038060416, -0.000208993684496, -0.000226081290712, -0.000241558391745, -0.000255350869641, -0.000267395829448, -0.000277641837343, -0.000286049086491, -0.000292589490539, -0.000297246705103, -0.000300016078023, -0.000300904529591, -0.000299930364345, -0.000297123016414, -0.000292522730793, -0.000286180183249, -0.000278156041926, -0.000268520473994, -0.000257352601014, -0.000244739906911, -0.00023077760273, -0.000215567952505, -0.000199219564799, -0.000181846654599, -0.000163568280364, -0.000144507561146, -0.000124790878716, -0.000104547069707, -8.3906612757e-05, -6.30008156011e-05, -4.19610070206e-05, -2.09177384594e-05, -6.72575950178e-19, 2.06655447462e-05, 4.09553004503e-05, 6.07494543859e-05, 7.99326592792e-05, 9.83946809495e-05, 0.000116031007252, 0.000132743415113, 0.000148440492734, 0.000163038114344, 0.000176459865203, 0.00018863741487, 0.000199510837108, 0.000209028875099, 0.000217149151043, 0.000223838319489, 0.000229072164162, 0.000232835638346, 0.000235122849234, 0.000235936986992, 0.000235290199616, 0.000233203414943, 0.000229706111527, 0.000224836040328, 0.000218638899478, 0.000211167964614, 0.000202483677526, 0.000192653196087, 0.000181749908607, 0.000169852915966, 0.000157046485015, 0.000143419476872, 0.000129064753854, 0.000114078568866, 9.85599411374e-05, 8.26100222307e-05, 6.63314562638e-05, 4.98277382766e-05, 3.32025746409e-05, 1.65592493568e-05, 5.59926582713e-18, -1.63745930139e-05, -3.24662003054e-05, -4.81793171422e-05, -6.34218135435e-05, -7.81054578096e-05, -9.21464106041e-05, -0.000105465686927, -0.000117989583533, -0.000129650069598, -0.000140385138662, -0.000150139120151, -0.000158862949033, -0.000166514392427, -0.000173058232277, -0.000178466403438, -0.000182718086847, -0.000185799757689, -0.000187705188745, -0.000188435409401};
+	return pulse;
+}
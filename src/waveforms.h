@@ -1,7 +1,26 @@
-
-/* This file was automatically generated by "generate_waveforms.py".
-   (C) 2014 Christophe Jacquet.
-   Released under the GNU GPL v3 license.
+/*
+ * mpxgen - FM multiplex encoder with Stereo and RDS
+ * Copyright (C) 2021 Anthony96922
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-extern float waveform_biphase[1120];
+/* windows that can be applied to the pulse shape */
+enum pulse_window {
+	PULSE_WINDOW_RECTANGULAR,	/* plain truncation */
+	PULSE_WINDOW_HANN
+};
+
+extern const float *create_biphase_pulse(uint32_t sample_rate,
+	uint8_t span, uint8_t window);